@@ -0,0 +1,244 @@
+/*
+ * Wii U Linux Launcher -- Find and load the ancast image
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <os_functions.h>
+#include "main.h"
+#include "fs.h"
+#include "hash.h"
+#include "hax.h"
+#include "load.h"
+#include "preflight.h"
+#include "ancast.h"
+
+/* Where Cafe OS keeps its own image: with the code of the OS title (OSv10) */
+static const char *const mlc_paths[] = {
+	"/vol/storage_mlc01/sys/title/00050010/1000400a/code/kernel.img",
+};
+#define NR_MLC_PATHS	((int)(sizeof(mlc_paths) / sizeof(mlc_paths[0])))
+
+#define CACHE_MAGIC	0x414e4341	/* "ANCA" */
+#define CACHE_VERSION	1
+
+/* The part of the image that preflight_ancast looks at */
+#define HEADER_SIZE	0x100
+
+/* How much is read from the MLC at a time */
+#define CHUNK_SIZE	0x10000
+
+#define MIN(a, b) (((a) < (b))? (a) : (b))
+
+struct ancast_cache {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint8_t digest[HASH_MAX_SIZE];
+	char path[128];
+	uint8_t header[HEADER_SIZE];
+};
+
+static struct ancast_cache cache;
+
+static void get_cache_path(char *buf, size_t size)
+{
+	snprintf(buf, size, "%s/wiiu/apps/linux/ancast.bin", sdcard_path);
+}
+
+static int load_cache(void)
+{
+	char path[256];
+	int res;
+
+	get_cache_path(path, sizeof path);
+	res = read_file_into_buffer(path, (u8 *)&cache, sizeof cache, NULL);
+	if (res != (int)sizeof cache || cache.magic != CACHE_MAGIC ||
+	    cache.version != CACHE_VERSION ||
+	    cache.path[sizeof cache.path - 1] != '\0' ||
+	    preflight_ancast(cache.header, HEADER_SIZE, cache.size) < 0) {
+		cache.magic = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Failing to write the cache only costs time on the next boot */
+static void save_cache(const char *path, const uint8_t *image, uint32_t size,
+		const uint8_t *digest)
+{
+	struct ancast_cache c;
+	char cache_path[256];
+
+	if (strlen(path) >= sizeof c.path)
+		return;
+
+	memset(&c, 0, sizeof c);
+	c.magic = CACHE_MAGIC;
+	c.version = CACHE_VERSION;
+	c.size = size;
+	memcpy(c.digest, digest, sizeof c.digest);
+	strcpy(c.path, path);
+	memcpy(c.header, image, HEADER_SIZE);
+
+	get_cache_path(cache_path, sizeof cache_path);
+	if (fs_replace_file(cache_path, (u8 *)&c, sizeof c) >= 0)
+		cache = c;
+}
+
+/*
+ * Read (up to) the first len bytes of a file on the MLC to dest, and its
+ * SHA-1 digest to digest, unless that's NULL. Returns the size of the whole
+ * file, or an error (negative).
+ */
+static int read_mlc(int fd, int fsa, const char *path, uint8_t *dest,
+		uint32_t len, uint8_t *digest)
+{
+	struct hash h;
+	uint32_t size, done = 0;
+	uint8_t *buf;
+	int handle, res;
+
+	handle = iosuhax_fsa_open_file(fd, fsa, path);
+	if (handle < 0)
+		return handle;
+
+	res = iosuhax_fsa_file_size(fd, fsa, handle, &size);
+	if (res < 0 || size > ANCAST_MAX_SIZE) {
+		iosuhax_fsa_close_file(fd, fsa, handle);
+		return -1;
+	}
+	len = MIN(len, size);
+	if (len == 0) {
+		iosuhax_fsa_close_file(fd, fsa, handle);
+		return size;
+	}
+
+	buf = xmalloc(IOSUHAX_FSA_READ_OFFSET + CHUNK_SIZE, 0x40);
+	if (digest)
+		hash_init(&h, HASH_SHA1);
+	while (done < len) {
+		res = iosuhax_fsa_read_file(fd, fsa, handle, buf,
+				MIN(CHUNK_SIZE, len - done));
+		if (res <= 0 || (uint32_t)res > len - done)
+			break;
+
+		memcpy(dest + done, buf + IOSUHAX_FSA_READ_OFFSET, res);
+		if (digest)
+			hash_update(&h, dest + done, res);
+		done += res;
+	}
+	xfree(buf);
+	iosuhax_fsa_close_file(fd, fsa, handle);
+
+	if (done < len)
+		return -1;
+	if (digest)
+		hash_final(&h, digest);
+
+	return size;
+}
+
+/*
+ * The image that ancast.bin names is tried first. If it still has the same
+ * digest, it is used as it is; any other image has to pass preflight_ancast,
+ * and is remembered for the next boot.
+ */
+static int load_from_mlc(int fd, int fsa, uint8_t *dest)
+{
+	uint8_t digest[HASH_MAX_SIZE];
+	const char *path;
+	int i, res, cached = (load_cache() == 0);
+
+	for (i = cached ? -1 : 0; i < NR_MLC_PATHS; i++) {
+		path = (i < 0)? cache.path : mlc_paths[i];
+		if (i >= 0 && cached && strcmp(path, cache.path) == 0)
+			continue;
+
+		res = read_mlc(fd, fsa, path, dest, ANCAST_MAX_SIZE, digest);
+		if (res < 0)
+			continue;
+
+		if (i < 0 && (uint32_t)res == cache.size &&
+		    memcmp(digest, cache.digest, hash_size(HASH_SHA1)) == 0)
+			return res;
+
+		if (preflight_ancast(dest, res, res) < 0)
+			continue;
+
+		save_cache(path, dest, res, digest);
+		return res;
+	}
+
+	return -1;
+}
+
+/*
+ * Called by preflight() in load.c: If the image on the MLC that ancast.bin
+ * names is still there, or another one can be found, ancast.img on the SD
+ * card doesn't matter. At most the header is read.
+ */
+int ancast_check_mlc(void)
+{
+	uint8_t header[HEADER_SIZE];
+	int fd, fsa, i, res = -1, cached = (load_cache() == 0);
+
+	fd = iosuhax_open();
+	if (fd < 0) {
+		/* boot() complains about that, if it comes to that */
+		warning[0] = '\0';
+		return fd;
+	}
+
+	fsa = iosuhax_fsa_open(fd);
+	if (fsa >= 0) {
+		/* A known image only has to be there, with the same size */
+		if (cached && read_mlc(fd, fsa, cache.path, header, 0, NULL) ==
+				(int)cache.size)
+			res = 0;
+
+		for (i = 0; i < NR_MLC_PATHS && res < 0; i++) {
+			res = read_mlc(fd, fsa, mlc_paths[i], header,
+					sizeof header, NULL);
+			if (res >= 0)
+				res = preflight_ancast(header,
+						MIN(res, HEADER_SIZE), res);
+		}
+		iosuhax_fsa_close(fd, fsa);
+	}
+
+	iosuhax_close(fd);
+	return res;
+}
+
+int ancast_load(int iosuhax, void *dest)
+{
+	int fsa, res = -1;
+
+	fsa = iosuhax_fsa_open(iosuhax);
+	if (fsa >= 0) {
+		res = load_from_mlc(iosuhax, fsa, dest);
+		iosuhax_fsa_close(iosuhax, fsa);
+	}
+
+	if (res >= 0)
+		return res;
+
+	return read_file_into_buffer(ANCAST_PATH, dest, ANCAST_MAX_SIZE,
+			"ancast image");
+}
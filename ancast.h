@@ -0,0 +1,36 @@
+/*
+ * Wii U Linux Launcher -- Find and load the ancast image
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The PPC ancast image that the ARM payload boots is normally read from the
+ * system's MLC, through iosuhax. ancast.bin, next to config.txt, remembers
+ * where it was found, along with its header and SHA-1 digest, so that a
+ * known image is neither searched for nor checked again. ancast.img on the
+ * SD card is only used when there's no image on the MLC.
+ */
+
+#ifndef _ANCAST_H
+#define _ANCAST_H
+
+/* 0 if boot() will find a good image on the MLC, or an error (negative) */
+extern int ancast_check_mlc(void);
+
+/* Read the image to dest, and return its size or an error (negative) */
+extern int ancast_load(int iosuhax, void *dest);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Wii U Linux Launcher -- Large buffers in MEM2
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <os_functions.h>
+#include "arena.h"
+
+/* The arena starts at a page boundary, and grows in steps of 1 MiB */
+#define ARENA_ALIGN		0x1000
+#define ARENA_STEP		(1 << 20)
+
+static uint8_t *arena;
+static size_t arena_size, arena_used;
+
+/* Give the arena back to the default heap, when a load doesn't need it */
+void arena_release(void)
+{
+	if (arena)
+		MEMFreeToExpHeap(MEMGetBaseHeapHandle(MEM_ARENA_2), arena);
+	arena = NULL;
+	arena_size = arena_used = 0;
+}
+
+/*
+ * Make sure that the arena can hold at least size bytes, and reset it.
+ * Returns -1 if there isn't enough memory; the old arena is gone then, too.
+ */
+int arena_reserve(size_t size)
+{
+	int heap = MEMGetBaseHeapHandle(MEM_ARENA_2);
+
+	arena_used = 0;
+	if (size <= arena_size)
+		return 0;
+
+	arena_release();
+
+	size = (size + ARENA_STEP - 1) & ~(ARENA_STEP - 1);
+	arena = MEMAllocFromExpHeapEx(heap, size, ARENA_ALIGN);
+	if (!arena)
+		return -1;
+
+	arena_size = size;
+	return 0;
+}
+
+/* align must be a power of two. Returns NULL if the arena is full. */
+void *arena_alloc(size_t size, size_t align)
+{
+	size_t start = (arena_used + align - 1) & ~(align - 1);
+
+	if (start > arena_size || size > arena_size - start)
+		return NULL;
+
+	arena_used = start + size;
+	return arena + start;
+}
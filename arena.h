@@ -0,0 +1,41 @@
+/*
+ * Wii U Linux Launcher -- Large buffers in MEM2
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * MEM1 is only 32 MiB, and part of it is taken by the framebuffers and the
+ * ancast image, so images that don't fit there (big initrds, mostly) are
+ * put into an arena in MEM2 instead: one block from the default heap, which
+ * is handed out front to back, and reset as a whole before each load. A
+ * load that doesn't need it gives it back to the heap. Linux finds the
+ * images at their physical addresses, which are in MEM2 too.
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* MEMGetBaseHeapHandle's number for MEM2, where the default heap lives */
+#define MEM_ARENA_2		1
+
+extern int arena_reserve(size_t size);
+extern void arena_release(void);
+extern void *arena_alloc(size_t size, size_t align);
+
+#endif
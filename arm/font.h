@@ -16,7 +16,7 @@
  * with this program, in the file LICENSE.GPLv2.
  */
 
-#define FONT_EVERYTHING 0
+#define FONT_EVERYTHING 1
 
 #if FONT_EVERYTHING
 #define FONT_OFFSET	0
@@ -21,7 +21,14 @@
 #include "main.h"
 #include "latte.h"
 #include "memory.h"
+#include "poll.h"
 #include "ppc.h"
+#include "../boottime.h"
+#include "../bootlog.h"
+#include "../memcons.h"
+#include "../purgatory/purgatory.h"
+
+#define MIN(x, y)	(((x) < (y))? (x):(y))
 
 /* Clear n 32-bit words at p with a given value */
 static void memset32(uint32_t *p, uint32_t value, unsigned long n)
@@ -40,6 +47,17 @@ static void memcpy32(uint32_t *d, const uint32_t *s, unsigned long n)
 		d[i] = s[i];
 }
 
+/* Copy n blocks of 32 bytes. GCC turns the loop body into an ldm/stm pair. */
+static void blkcpy32(uint32_t *d, const uint32_t *s, unsigned long n)
+{
+	while (n--) {
+		d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+		d[4] = s[4]; d[5] = s[5]; d[6] = s[6]; d[7] = s[7];
+		d += 8;
+		s += 8;
+	}
+}
+
 void memset(void *ptr, uint8_t value, unsigned long n)
 {
 	unsigned long i;
@@ -110,6 +128,13 @@ void udelay(uint32_t usec)
 static uint32_t *const fb_drc = (void *)0x00708000;
 static const uint32_t stride_drc = 896;
 
+/*
+ * Set once the PPC runs, if the launcher said so (PURGATORY_NO_DRC): when
+ * Linux got the gamepad's framebuffer, or the kernel is moved over it.
+ * Nothing is drawn into it after that.
+ */
+static int no_drc;
+
 static void put_glyph(uint32_t *fb, unsigned int stride, const uint8_t *glyphs)
 {
 	int row, col;
@@ -141,7 +166,8 @@ static void put_char_xy(uint32_t *fb, unsigned stride, int x, int y, char c)
 
 static void put_char_xy_drc(int x, int y, char c)
 {
-	put_char_xy(fb_drc, stride_drc, x, y, c);
+	if (!no_drc)
+		put_char_xy(fb_drc, stride_drc, x, y, c);
 }
 
 static void put_str_xy(uint32_t *fb, unsigned stride, int x, int y, const char *str)
@@ -154,7 +180,8 @@ static void put_str_xy(uint32_t *fb, unsigned stride, int x, int y, const char *
 
 static void put_str_xy_drc(int x, int y, const char *str)
 {
-	put_str_xy(fb_drc, stride_drc, x, y, str);
+	if (!no_drc)
+		put_str_xy(fb_drc, stride_drc, x, y, str);
 }
 
 static void put_hex_xy(uint32_t *fb, unsigned stride, int x, int y, uint32_t value)
@@ -174,7 +201,8 @@ static void put_hex_xy(uint32_t *fb, unsigned stride, int x, int y, uint32_t val
 
 static void put_hex_xy_drc(int x, int y, uint32_t value)
 {
-	put_hex_xy(fb_drc, stride_drc, x, y, value);
+	if (!no_drc)
+		put_hex_xy(fb_drc, stride_drc, x, y, value);
 }
 
 void font_test(uint32_t *fb, unsigned int stride)
@@ -199,10 +227,69 @@ void font_test(uint32_t *fb, unsigned int stride)
 	}
 }
 
+/*
+ * The boot log. See ../bootlog.h
+ */
+
+static struct bootlog *const bootlog = (void *)BOOTLOG_PHYS;
+
+static void bootlog_init(void)
+{
+	memset(bootlog, 0, sizeof *bootlog);
+	bootlog->magic = BOOTLOG_MAGIC;
+	bootlog->csum = bootlog_csum(1, bootlog->data, 0);
+	dc_flushrange(bootlog, sizeof *bootlog);
+}
+
+/* Append up to n bytes of text; a NUL ends it early */
+static void bootlog_write(const char *p, uint32_t n)
+{
+	uint32_t len = bootlog->len, i;
+
+	for (i = 0; i < n && p[i]; i++)
+		;
+	n = i;
+
+	if (n > BOOTLOG_DATA_SIZE - len) {
+		bootlog->lost += n - (BOOTLOG_DATA_SIZE - len);
+		n = BOOTLOG_DATA_SIZE - len;
+	}
+
+	memcpy(bootlog->data + len, p, n);
+	dc_flushrange(bootlog->data + len, n);
+
+	bootlog->csum = bootlog_csum(bootlog->csum, bootlog->data + len, n);
+	bootlog->len = len + n;
+	dc_flushrange(bootlog, sizeof *bootlog);
+}
+
+static void bootlog_puts(const char *str)
+{
+	bootlog_write(str, strlen(str));
+}
+
+static void bootlog_hex(uint32_t x)
+{
+	char buf[11];
+	int i;
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (i = 0; i < 8; i++)
+		buf[2 + i] = "0123456789abcdef"[(x >> (28 - 4 * i)) & 0xf];
+	buf[10] = '\0';
+
+	bootlog_puts(buf);
+}
+
 static void fail_with_hex(const char *reason, uint32_t value)
 {
 	put_str_xy_drc(0x18,                  0x10, reason);
 	put_hex_xy_drc(0x18 + strlen(reason), 0x10, value);
+
+	bootlog_puts(reason);
+	bootlog_hex(value);
+	bootlog_puts("\n");
 }
 
 static void hexdump(void *base, uint32_t length)
@@ -280,36 +367,126 @@ static int copy_ancast_image(void *base, void *dest)
 	return 0;
 }
 
-void *const MEM0_MEMCONS = (void *)0x08200000;
-void display_memconsole(void)
+/*
+ * The memory console. See ../memcons.h for the protocol.
+ */
+
+static struct memcons *const memcons = (void *)MEMCONS_PHYS;
+
+/* The area of the gamepad screen that the memory console may use */
+#define CONS_LEFT	0x02
+#define CONS_RIGHT	0x6a
+#define CONS_TOP	0x10
+#define CONS_BOTTOM	0x3c
+
+static unsigned cons_x = CONS_LEFT, cons_y = CONS_TOP;
+
+static void memcons_init(void)
+{
+	memset(memcons, 0, MEMCONS_OFF_DATA);
+	memcons->magic = MEMCONS_MAGIC;
+	memcons->size = MEMCONS_SIZE;
+	dc_flushrange(memcons, MEMCONS_OFF_DATA);
+}
+
+/* Append a string to the memory console, like the PPC would */
+static void memcons_puts(const char *str)
 {
-	char *memcons = MEM0_MEMCONS;
-	unsigned pos = 0;
-	unsigned x = 0x10, y = 0x10;
+	uint32_t head = memcons->head;
+
+	while (*str)
+		memcons->data[head++ & (MEMCONS_SIZE - 1)] = *str++;
+
+	dc_flushrange(memcons->data, MEMCONS_SIZE);
+	memcons->head = head;
+	dc_flushrange(&memcons->head, 4);
+}
+
+/* Move everything in the console area up by one line of text */
+static void cons_scroll(void)
+{
+	uint32_t *top = fb_drc + 8 * CONS_TOP * stride_drc;
+	uint32_t line = 8 * stride_drc;
+
+	if (no_drc)
+		return;
 
-	while(1) {
-		dc_invalidaterange(memcons, 4);
-		uint32_t new_pos = *(volatile uint32_t *)memcons;
+	blkcpy32(top, top + line, (CONS_BOTTOM - CONS_TOP - 1) * line / 8);
+	memset32(top + (CONS_BOTTOM - CONS_TOP - 1) * line, 0xffff00ff, line);
+}
 
-		if (pos < new_pos)
-			/* invalidate the cache before reading the new chars */
-			dc_invalidaterange(memcons + pos, new_pos - pos);
+static void cons_newline(void)
+{
+	cons_x = CONS_LEFT;
 
-		while (pos < new_pos) {
-			char c = memcons[4 + pos++];
+	if (cons_y + 1 < CONS_BOTTOM)
+		cons_y++;
+	else
+		cons_scroll();
+}
+
+/* Render n bytes of text. Returns 1 if the end of the console was reached. */
+static int cons_write(const char *p, uint32_t n)
+{
+	uint32_t i;
 
-			switch(c) {
-			case '\n':
-				y++;
-				x = 0x10;
-				break;
-			case '\0':
+	for (i = 0; i < n; i++) {
+		switch (p[i]) {
+		case '\0':
+			return 1;
+		case '\n':
+			cons_newline();
+			break;
+		default:
+			if (cons_x >= CONS_RIGHT)
+				cons_newline();
+			put_char_xy_drc(cons_x++, cons_y, p[i]);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Poll the memory console every 100µs while text is coming in, and back off
+ * to 20ms while the PPC is quiet.
+ */
+void display_memconsole(struct poll *poll)
+{
+	uint32_t tail = 0, head;
+
+	poll_init(poll, 100, 20000);
+
+	while (1) {
+		poll_wait(poll);
+		dc_invalidaterange(&memcons->head, 4);
+		head = read32(&memcons->head);
+
+		poll_update(poll, head != tail);
+		if (head == tail)
+			continue;
+
+		/* Did the PPC overtake us? Skip what has already been overwritten. */
+		if (head - tail > MEMCONS_SIZE) {
+			memcons->overflow += head - tail - MEMCONS_SIZE;
+			tail = head - MEMCONS_SIZE;
+		}
+
+		/* The new text is at most two contiguous pieces of the ring */
+		while (tail != head) {
+			uint32_t off = tail & (MEMCONS_SIZE - 1);
+			uint32_t n = MIN(head - tail, MEMCONS_SIZE - off);
+
+			dc_invalidaterange(memcons->data + off, n);
+			bootlog_write(memcons->data + off, n);
+			if (cons_write(memcons->data + off, n))
 				return;
-			default:
-				put_char_xy_drc(x++, y, c);
-				break;
-			}
+			tail += n;
 		}
+
+		memcons->tail = tail;
+		dc_flushrange(&memcons->tail, 8);
 	}
 }
 
@@ -333,12 +510,15 @@ void ppc_patch_entry(void *ancast, uint32_t entry)
  * Flip the switch to turn on the PPC, then wait for the bootrom to decrypt the
  * first instruction of the provided ancast image, and overwrite it with a jump
  * into our payload.
+ *
+ * The first instruction is polled every 1-4µs, which is still quick enough to
+ * win the race, but leaves the bus to the PPC most of the time. The bootrom
+ * status is only checked on every 64th poll.
  */
-int ppc_start_and_race(void *ancast, uint32_t entry)
+int ppc_start_and_race(void *ancast, uint32_t entry, struct poll *poll)
 {
 	volatile uint32_t *first_insn = (void *)((uint32_t)ancast + 0x100);
 	uint32_t old;
-	uint32_t start_time = gettime();
 
 	old = *first_insn;
 
@@ -350,11 +530,18 @@ int ppc_start_and_race(void *ancast, uint32_t entry)
 	memset(rom_state, 0, 0x20);
 	dc_flushrange(rom_state, 0x20);
 
+	poll_init(poll, 1, 4);
+
 	while (1) {
+		poll_wait(poll);
 		dc_invalidaterange((uint32_t *)first_insn, 4);
 
 		if (*first_insn != old)
 			break;
+		poll_update(poll, 0);
+
+		if (poll->count % 64)
+			continue;
 
 		/* Did the bootrom report an error? */
 		dc_invalidaterange(&rom_state[7], 4);
@@ -362,7 +549,7 @@ int ppc_start_and_race(void *ancast, uint32_t entry)
 		if (status >> 24 != 0)
 			return status;
 
-		if (gettime() - start_time > 100000000)
+		if (poll_elapsed_us(poll) > 50000000)
 			return -1;
 	}
 
@@ -405,7 +592,6 @@ static uint32_t sha1_wait(void)
 	return status & SHA_CTRL_ERR;
 }
 
-#define MIN(x, y)	(((x) < (y))? (x):(y))
 static int sha1_update(char *p, uint32_t size)
 {
 	uint32_t offset = 0;
@@ -470,19 +656,75 @@ static void test_mem_range(int y, char *p, char *q)
 }
 
 
+/*
+ * Boot timing. See ../boottime.h
+ */
+
+static struct boottime *const boottime = (void *)BOOTTIME_PHYS;
+
+static void boottime_init(void)
+{
+	memset(boottime, 0, sizeof *boottime);
+	boottime->magic = BOOTTIME_MAGIC;
+	boottime->version = BOOTTIME_VERSION;
+	boottime->size = sizeof *boottime;
+	boottime->arm_hz = 243000000 / 128;
+	dc_flushrange(boottime, sizeof *boottime);
+}
+
+static void boottime_stamp(unsigned step, int done)
+{
+	uint32_t now = gettime();
+
+	if (step >= BOOTTIME_ARM_STEPS)
+		return;
+
+	if (done) {
+		boottime->arm[step].done = now;
+	} else {
+		boottime->arm[step].start = now;
+		if (boottime->arm_count <= step)
+			boottime->arm_count = step + 1;
+	}
+
+	/* Only flush what the ARM owns */
+	dc_flushrange(boottime, BOOTTIME_OFF_PPC_COUNT);
+}
+
+
 /*
  * main and related functions
  */
 
+/* The line of the first log message. Each line is one step in boottime.h */
+#define LOG_FIRST	0x0a
+
 static void log_str(int y, const char *str)
 {
+	boottime_stamp(y - LOG_FIRST, 0);
 	put_str_xy_drc(0x10, y, "[....]");
 	put_str_xy_drc(0x18, y, str);
+
+	bootlog_puts("arm: ");
+	bootlog_puts(str);
+	bootlog_puts("\n");
 }
 
 static void log_done(int y)
 {
+	boottime_stamp(y - LOG_FIRST, 1);
 	put_str_xy_drc(0x11, y, "done");
+
+	bootlog_puts("arm: done\n");
+}
+
+/* Show how often a polling loop polled, and how long it took */
+static void log_poll(int y, const struct poll *poll)
+{
+	put_hex_xy_drc(0x40, y, poll->count);
+	put_str_xy_drc(0x49, y, "polls");
+	put_hex_xy_drc(0x50, y, poll_elapsed_us(poll));
+	put_str_xy_drc(0x59, y, "us");
 }
 
 static void hexdump_kernel(void)
@@ -492,10 +734,18 @@ static void hexdump_kernel(void)
 	put_str_xy_drc(0xe, 0x2c, ">");		/* mark the entry point */
 }
 
-extern uint32_t svc_0x53_arguments[];
-int main(void)
+/*
+ * svc_0x53_arguments points to the header at the start of stage 1 (see
+ * start.S).
+ */
+int main(const uint32_t *svc_0x53_arguments)
 {
-	int logline = 0x0a;
+	const uint32_t ppc_entry = svc_0x53_arguments[2];
+	int logline = LOG_FIRST;
+	uint32_t flags;
+
+	boottime_init();
+	bootlog_init();
 
 	memset32(fb_drc, 0xffff00ff, 896 * 504);		/* yellow */
 	font_test(fb_drc, stride_drc);
@@ -505,6 +755,10 @@ int main(void)
 	ppc_hang();
 	log_done(logline++);
 
+	/* The launcher's flags, in the purgatory header at the PPC's entry */
+	dc_invalidaterange((void *)(ppc_entry + PURGATORY_OFF_FLAGS), 4);
+	flags = read32(ppc_entry + PURGATORY_OFF_FLAGS);
+
 	hexdump_kernel();
 
 	log_str(logline, "Copying ancast image");
@@ -517,11 +771,9 @@ int main(void)
 
 	log_str(logline, "Configuring misc. things");
 
-	/* write a dummy string into the memconsole */
-	char *memcons = MEM0_MEMCONS;
-	*(uint32_t *)memcons = 15;
-	memcpy(memcons + 4, "Hello world\nfoo", 15);
-	dc_flushrange(memcons, 20);
+	/* Set up the memory console and write a dummy string into it */
+	memcons_init();
+	memcons_puts("Hello world\n");
 
 	/* Allow the PPC to access all memory and MMIO */
 	write32(LT_AHBPROT, -1);
@@ -529,7 +781,9 @@ int main(void)
 	log_done(logline++);
 
 	log_str(logline, "Racing the PPC bootrom");
-	int ret = ppc_start_and_race(ancast_dest, svc_0x53_arguments[2]);
+	struct poll poll;
+	int ret = ppc_start_and_race(ancast_dest, ppc_entry, &poll);
+	log_poll(logline, &poll);
 	if (ret != 0) {
 		fail_with_hex("ppc_start_and_race failed: ", ret);
 		return 0;
@@ -537,7 +791,12 @@ int main(void)
 	hexdump_kernel();
 	log_done(logline++);
 
-	display_memconsole();
+	log_str(logline, "Memory console");
+	if (flags & PURGATORY_NO_DRC)
+		no_drc = 1;
+	display_memconsole(&poll);
+	log_poll(logline, &poll);
+	log_done(logline++);
 
 	/*
 	 * A small memory map:
@@ -548,6 +807,13 @@ int main(void)
 	 * MEM2		everyone	10000000	80000000
 	 * SRAM1	IOSU k. heap	fff00000	00008000
 	 * SRAM0	IOSU kernel	ffff0000	00010000
+	 *
+	 * Within MEM0, the ancast image occupies 08000000-08200000, and the
+	 * memory console (see memcons.h) starts at 08200000, the boot log (see
+	 * bootlog.h) is at 08250000, stage 2 of the ARM code runs at 08280000
+	 * (see stage1.c), the boot timing record (see boottime.h) is at
+	 * 082c0000, and the purgatory runs at 082d0000 (see
+	 * purgatory/purgatory.h).
 	 */
 
 	return 0;
@@ -17,6 +17,7 @@ void _dc_inval_entries(void *start, int count);
 void _dc_flush_entries(const void *start, int count);
 void _dc_flush(void);
 void _drain_write_buffer(void);
+void _ic_inval(void);
 
 #define LINESIZE 0x20
 #define CACHESIZE 0x4000
@@ -219,5 +220,10 @@ void dc_invalidaterange(void *start, u32 size)
 	irq_restore(cookie);
 }
 
-/* dc_flushall, ic_invalidateall, mem_protect, mem_setswap, map_section,
+void ic_invalidateall(void)
+{
+	_ic_inval();
+}
+
+/* dc_flushall, mem_protect, mem_setswap, map_section,
  * mem_initialize, and mem_shutdown omitted */
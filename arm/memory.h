@@ -30,6 +30,7 @@ enum AHBDEV {
 
 void dc_flushrange(const void *start, u32 size);
 void dc_invalidaterange(void *start, u32 size);
+void ic_invalidateall(void);
 
 #endif
 
@@ -0,0 +1,62 @@
+/*
+ * Wii U Linux Launcher -- Rate-limited polling of shared memory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include "main.h"
+#include "latte.h"
+#include "poll.h"
+
+/* LT_TIMER runs at ~1.9MHz, see udelay */
+#define US_TO_TICKS(us)		(2 * (us))
+#define TICKS_TO_US(ticks)	((ticks) / 2)
+
+void poll_init(struct poll *p, uint32_t min_us, uint32_t max_us)
+{
+	p->min = US_TO_TICKS(min_us);
+	p->max = US_TO_TICKS(max_us);
+	p->interval = p->min;
+	p->start = read32(LT_TIMER);
+	p->last = p->start - p->interval;	/* the first poll is due now */
+	p->count = 0;
+}
+
+void poll_wait(struct poll *p)
+{
+	uint32_t now;
+
+	do {
+		now = read32(LT_TIMER);
+	} while (now - p->last < p->interval);
+
+	p->last = now;
+	p->count++;
+}
+
+void poll_update(struct poll *p, int busy)
+{
+	if (busy)
+		p->interval = p->min;
+	else if (p->interval < p->max / 2)
+		p->interval = p->interval * 2 + 1;
+	else
+		p->interval = p->max;
+}
+
+uint32_t poll_elapsed_us(const struct poll *p)
+{
+	return TICKS_TO_US(read32(LT_TIMER) - p->start);
+}
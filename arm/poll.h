@@ -0,0 +1,52 @@
+/*
+ * Wii U Linux Launcher -- Rate-limited polling of shared memory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _POLL_H
+#define _POLL_H
+
+#include <stdint.h>
+
+/*
+ * Every cache invalidation on the ARM goes through ahb_flush_to, which
+ * competes with the PPC for the bus. A struct poll makes sure that a polling
+ * loop doesn't invalidate more often than it needs to: The interval between
+ * two polls starts at min, doubles every time a poll finds nothing new, and
+ * is reset to min as soon as something happens.
+ *
+ * All times are in LT_TIMER ticks.
+ */
+struct poll {
+	uint32_t interval;	/* current interval between polls */
+	uint32_t min, max;	/* bounds for interval */
+	uint32_t start;		/* time of poll_init */
+	uint32_t last;		/* time of the last poll */
+	uint32_t count;		/* number of polls so far */
+};
+
+extern void poll_init(struct poll *p, uint32_t min_us, uint32_t max_us);
+
+/* Wait until the next poll is due */
+extern void poll_wait(struct poll *p);
+
+/* Report whether the last poll found something to do */
+extern void poll_update(struct poll *p, int busy);
+
+/* How many microseconds have passed since poll_init? */
+extern uint32_t poll_elapsed_us(const struct poll *p);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Wii U Linux Launcher -- First stage of the ARM code
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Stage 1 runs from the 4 KiB at 0xfffff000, which is all that the PPC can
+ * conveniently upload through /dev/iosuhax. It copies the second stage from
+ * the MEM2 buffer that the PPC prepared, decompressing it if it's packed (see
+ * unlz.h), and jumps to it. Stage 2 has no such size limit.
+ */
+
+#include <stdint.h>
+#include "main.h"
+#include "memory.h"
+#include "unlz.h"
+
+typedef void (*stage2_entry_t)(const uint32_t *svc_0x53_arguments);
+
+void stage1(const uint32_t *svc_0x53_arguments, uint8_t *src, uint32_t size)
+{
+	uint8_t *dest = (void *)ARM_STAGE2_ADDR;
+	unsigned long len, i;
+
+	/* The PPC has flushed stage 2 to RAM, but we may have stale lines */
+	dc_invalidaterange(src, size);
+
+	len = unlz_size(src);
+	if (len) {
+		if (len > ARM_STAGE2_SIZE)
+			return;
+		unlz(dest, src);
+	} else {
+		len = size;
+		if (len > ARM_STAGE2_SIZE)
+			return;
+		for (i = 0; i < len; i++)
+			dest[i] = src[i];
+	}
+
+	dc_flushrange(dest, len);
+	ic_invalidateall();
+
+	((stage2_entry_t)dest)(svc_0x53_arguments);
+}
@@ -0,0 +1,96 @@
+/*
+ * Wii U Linux Launcher -- LZ4 block decompression
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * This file is used by the first stage on the ARM, and by the packer on the
+ * build host (tools/lzpack.c). It has to stay small, because the first stage
+ * has to fit into 4 KiB.
+ */
+
+#include <stdint.h>
+#include "unlz.h"
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | p[3];
+}
+
+/* Read an LZ4 length: 15 in the token means "more bytes follow" */
+static unsigned long get_len(const uint8_t **s, unsigned long len)
+{
+	uint8_t b;
+
+	if (len == 15) {
+		do {
+			b = *(*s)++;
+			len += b;
+		} while (b == 255);
+	}
+
+	return len;
+}
+
+unsigned long unlz_size(const void *packed)
+{
+	const uint8_t *s = packed;
+
+	if (get_be32(s) != UNLZ_MAGIC)
+		return 0;
+
+	return get_be32(s + 8);
+}
+
+unsigned long unlz(void *dst, const void *packed)
+{
+	const uint8_t *s = packed;
+	const uint8_t *end;
+	uint8_t *d = dst;
+	unsigned long len, offset;
+
+	if (get_be32(s) != UNLZ_MAGIC)
+		return 0;
+
+	end = s + UNLZ_HEADER + get_be32(s + 4);
+	s += UNLZ_HEADER;
+
+	while (s < end) {
+		uint8_t token = *s++;
+
+		/* Literals */
+		len = get_len(&s, token >> 4);
+		while (len--)
+			*d++ = *s++;
+
+		/* The last sequence has no match */
+		if (s >= end)
+			break;
+
+		/* Match: copy bytewise, because source and destination may
+		 * overlap */
+		offset = s[0] | s[1] << 8;
+		s += 2;
+		len = get_len(&s, token & 15) + 4;
+		while (len--) {
+			*d = *(d - offset);
+			d++;
+		}
+	}
+
+	return d - (uint8_t *)dst;
+}
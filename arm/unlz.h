@@ -0,0 +1,42 @@
+/*
+ * Wii U Linux Launcher -- LZ4 block decompression
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _UNLZ_H
+#define _UNLZ_H
+
+/*
+ * A packed payload is a 12-byte header followed by an LZ4 block, padded to a
+ * multiple of four bytes:
+ *
+ *   0x0  magic (UNLZ_MAGIC)
+ *   0x4  size of the LZ4 block
+ *   0x8  size of the decompressed data
+ *
+ * The header fields are big-endian.
+ */
+#define UNLZ_MAGIC	0x4c5a3442	/* "LZ4B" */
+#define UNLZ_HEADER	12
+
+/* Return the decompressed size of a packed payload, or 0 if it isn't one */
+extern unsigned long unlz_size(const void *packed);
+
+/* Decompress a packed payload. Returns the decompressed size, or 0 if the
+ * header is invalid. */
+extern unsigned long unlz(void *dst, const void *packed);
+
+#endif
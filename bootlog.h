@@ -0,0 +1,86 @@
+/*
+ * Wii U Linux Launcher -- boot log protocol
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The boot log is a copy of everything that went through the memory console
+ * (see memcons.h), plus the ARM's own progress messages, in a part of MEM0
+ * that the next start of Cafe OS may leave alone. The launcher looks for it
+ * when it starts, so that a boot that hung before Linux could write anything
+ * to storage can still be diagnosed.
+ *
+ * The ARM is the only writer: It clears the log before it starts the PPC,
+ * and appends the console text as it displays it, so that the purgatory's
+ * and Linux's output ends up here, too. It writes the data first, and then
+ * len and csum together (they share a cache line). Text beyond the end of
+ * data is counted in lost.
+ *
+ * csum is bootlog_csum() of the len bytes of data. Whatever doesn't match is
+ * treated as garbage, which is what MEM0 holds if the log didn't survive.
+ */
+
+#ifndef _BOOTLOG_H
+#define _BOOTLOG_H
+
+#define BOOTLOG_PHYS		0x08250000
+#define BOOTLOG_MAGIC		0x424c4f47	/* "BLOG" */
+#define BOOTLOG_SIZE		0x00030000	/* including the header */
+#define BOOTLOG_DATA_SIZE	(BOOTLOG_SIZE - 0x20)
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+struct bootlog {
+	uint32_t magic;
+	uint32_t len;
+	uint32_t csum;
+	uint32_t lost;
+	uint32_t pad[4];
+
+	char data[];
+};
+
+/*
+ * Adler-32, like purgatory_csum(), but it can be continued: Pass 1 to start,
+ * or the checksum of what came before.
+ */
+static inline uint32_t bootlog_csum(uint32_t csum, const void *data,
+		uint32_t len)
+{
+	const uint8_t *p = data;
+	uint32_t a = csum & 0xffff, b = csum >> 16;
+	uint32_t n;
+
+	while (len) {
+		/* 5552 bytes is the most that can be summed without overflow */
+		n = (len < 5552)? len : 5552;
+		len -= n;
+
+		while (n--) {
+			a += *p++;
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return (b << 16) | a;
+}
+#endif
+
+#endif
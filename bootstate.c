@@ -0,0 +1,65 @@
+/*
+ * Wii U Linux Launcher -- The boot attempt counter
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <os_functions.h>
+#include "main.h"
+#include "fs.h"
+#include "bootstate.h"
+
+static struct bootstate state __attribute__((aligned(0x40)));
+
+static void get_bootstate_path(char *buf, size_t size)
+{
+	snprintf(buf, size, "%s/wiiu/apps/linux/bootstate.bin", sdcard_path);
+}
+
+/* How often has the primary entry been booted since Linux last came up? */
+uint32_t bootstate_read(void)
+{
+	char path[256];
+	int res;
+
+	get_bootstate_path(path, sizeof path);
+	res = read_file_into_buffer(path, (u8 *)&state, sizeof state, NULL);
+	if (res < 12 || state.magic != BOOTSTATE_MAGIC ||
+	    state.check != ~state.attempts)
+		return 0;
+
+	return state.attempts;
+}
+
+int bootstate_write(uint32_t attempts)
+{
+	char path[256];
+	int res;
+
+	memset(&state, 0, sizeof state);
+	state.magic = BOOTSTATE_MAGIC;
+	state.attempts = attempts;
+	state.check = ~attempts;
+
+	get_bootstate_path(path, sizeof path);
+	res = fs_overwrite_file(path, (u8 *)&state, sizeof state);
+	if (res < 0)
+		warnf("Failed to write bootstate.bin: %s (%d)",
+				FS_strerror(res), res);
+
+	return res;
+}
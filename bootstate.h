@@ -0,0 +1,47 @@
+/*
+ * Wii U Linux Launcher -- The boot attempt counter
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * bootstate.bin (next to config.txt) counts how often the primary entry has
+ * been booted without Linux coming up. It is one sector long, and always
+ * written in place, in one go. Anything that isn't a valid state (such as
+ * zeros, or a missing file) counts as zero attempts, so Linux can reset the
+ * counter with:
+ *
+ *	dd if=/dev/zero of=bootstate.bin bs=512 count=1 conv=notrunc
+ */
+
+#ifndef _BOOTSTATE_H
+#define _BOOTSTATE_H
+
+#include <stdint.h>
+
+#define BOOTSTATE_MAGIC		0x57554253	/* "WUBS" */
+#define BOOTSTATE_SIZE		512
+
+struct bootstate {
+	uint32_t magic;
+	uint32_t attempts;
+	uint32_t check;		/* ~attempts */
+	uint8_t pad[BOOTSTATE_SIZE - 12];
+};
+
+extern uint32_t bootstate_read(void);
+extern int bootstate_write(uint32_t attempts);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Wii U Linux Launcher -- boot timing record
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The boot timing record is a small structure in MEM0, in which the ARM
+ * payload and the purgatory note down when they reached which step of the
+ * boot process. The launcher tells Linux where it is through the
+ * "wiiu,boot-timing" property in /chosen (<address size>).
+ *
+ * The ARM clears the record before it starts the PPC, and afterwards only
+ * writes the first three cache lines. The PPC only writes the last two.
+ */
+
+#ifndef _BOOTTIME_H
+#define _BOOTTIME_H
+
+#define BOOTTIME_PHYS		0x082c0000
+#define BOOTTIME_MAGIC		0x54494d45	/* "TIME" */
+#define BOOTTIME_VERSION	1
+#define BOOTTIME_SIZE		0xa0
+
+/* The ARM steps, in the order they are logged on the gamepad */
+#define BOOTTIME_ARM_HALT	0	/* halting the PPC */
+#define BOOTTIME_ARM_ANCAST	1	/* copying the ancast image */
+#define BOOTTIME_ARM_CONFIG	2	/* setting up MEM0 and AHBPROT */
+#define BOOTTIME_ARM_RACE	3	/* racing the PPC bootrom */
+#define BOOTTIME_ARM_MEMCONS	4	/* showing the memory console */
+#define BOOTTIME_ARM_STEPS	8
+
+/* The PPC stamps */
+#define BOOTTIME_PPC_ENTRY	0	/* purgatory was entered */
+#define BOOTTIME_PPC_KERNEL	1	/* purgatory is about to enter the kernel */
+#define BOOTTIME_PPC_STAMPS	7
+
+/* Offsets for use in assembly code */
+#define BOOTTIME_OFF_PPC_COUNT	0x60
+#define BOOTTIME_OFF_PPC	0x68
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+struct boottime {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;		/* sizeof(struct boottime) */
+	uint32_t arm_hz;	/* frequency of LT_TIMER */
+	uint32_t arm_count;	/* number of valid entries in arm[] */
+	uint32_t pad0[3];
+
+	/* LT_TIMER values at the start and the end of each ARM step */
+	struct {
+		uint32_t start, done;
+	} arm[BOOTTIME_ARM_STEPS];
+
+	/* Timebase values (upper and lower half) at each PPC stamp */
+	uint32_t ppc_count;	/* number of valid entries in ppc[] */
+	uint32_t pad1;
+	struct {
+		uint32_t tbu, tbl;
+	} ppc[BOOTTIME_PPC_STAMPS];
+};
+#endif
+
+#endif
@@ -0,0 +1,405 @@
+/*
+ * Wii U Linux Launcher -- boot configuration parser
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * This file doesn't depend on anything from Cafe OS, so that it can be
+ * tested on the build host (see tools/cfgtest.c).
+ */
+
+#include <string.h>
+#include "config.h"
+
+/* The keys that make up an entry. Everything else is an option. */
+static const char *const entry_keys[] = {
+	"kernel", "dtb", "initrd", "cmdline"
+};
+#define NR_ENTRY_KEYS	4
+
+/* Where variables are looked up; one level for the globals, one for the
+ * current section */
+#define MAX_VARS	64
+
+struct var {
+	uint16_t key, key_len;
+	uint16_t value;
+};
+
+struct parser {
+	struct config *c;
+	const char *sdcard;
+	int line;
+
+	struct var vars[MAX_VARS];
+	int nglobals, nvars;
+
+	/* The defaults for all entries */
+	uint16_t defaults[NR_ENTRY_KEYS];
+};
+
+static uint16_t *entry_field(struct config_entry *e, int i)
+{
+	switch (i) {
+	case 0:  return &e->kernel;
+	case 1:  return &e->dtb;
+	case 2:  return &e->initrd;
+	default: return &e->cmdline;
+	}
+}
+
+static int is_space(char ch)
+{
+	return ch == ' ' || ch == '\t';
+}
+
+static int key_is(const struct config *c, uint16_t key, size_t key_len,
+		const char *name)
+{
+	return strncmp(c->pool + key, name, key_len) == 0 &&
+	       name[key_len] == '\0';
+}
+
+/* Find a variable, the latest assignment first */
+static const struct var *find_var(const struct parser *ps, const char *name,
+		size_t len)
+{
+	int i;
+
+	for (i = ps->nvars - 1; i >= 0; i--)
+		if (ps->vars[i].key_len == len &&
+		    strncmp(ps->c->pool + ps->vars[i].key, name, len) == 0)
+			return &ps->vars[i];
+
+	return NULL;
+}
+
+static int append(struct parser *ps, const char *s, size_t len)
+{
+	struct config *c = ps->c;
+
+	if (c->pool_used + len >= CONFIG_POOL_SIZE)
+		return CONFIG_ERR_TOOBIG;
+
+	memcpy(c->pool + c->pool_used, s, len);
+	c->pool_used += len;
+	return 0;
+}
+
+/*
+ * Expand the variables in a value. Values without a '$' are used in place.
+ * Returns the offset of the result, or a negative error.
+ */
+static int expand(struct parser *ps, char *value)
+{
+	struct config *c = ps->c;
+	const struct var *var;
+	const char *name, *s;
+	char *p = value, *close;
+	int start, res;
+
+	if (!strchr(value, '$'))
+		return value - c->pool;
+
+	start = c->pool_used;
+	while (*p) {
+		if (p[0] != '$' || (p[1] != '$' && p[1] != '{')) {
+			s = p;
+			while (*p && *p != '$')
+				p++;
+			if (s == p)
+				p++;
+			res = append(ps, s, p - s);
+		} else if (p[1] == '$') {
+			res = append(ps, "$", 1);
+			p += 2;
+		} else {
+			name = p + 2;
+			close = strchr(name, '}');
+			if (!close)
+				return CONFIG_ERR_SYNTAX;
+
+			var = find_var(ps, name, close - name);
+			if (var) {
+				s = c->pool + var->value;
+				res = append(ps, s, strlen(s));
+			} else if (close - name == 6 &&
+				   strncmp(name, "sdcard", 6) == 0) {
+				res = append(ps, ps->sdcard, strlen(ps->sdcard));
+			} else {
+				/* Undefined variables are empty */
+				res = 0;
+			}
+			p = close + 1;
+		}
+
+		if (res < 0)
+			return res;
+	}
+
+	res = append(ps, "", 1);
+	return (res < 0)? res : start;
+}
+
+/* Start a new entry. name is NUL-terminated in place. */
+static int new_entry(struct parser *ps, char *name)
+{
+	struct config *c = ps->c;
+	struct config_entry *e;
+	int i;
+
+	if (c->nentries == CONFIG_MAX_ENTRIES)
+		return CONFIG_ERR_TOOMANY;
+
+	/* The section's variables are forgotten */
+	ps->nvars = ps->nglobals;
+
+	e = &c->entries[c->nentries++];
+	e->name = name - c->pool;
+	for (i = 0; i < NR_ENTRY_KEYS; i++)
+		*entry_field(e, i) = ps->defaults[i];
+
+	return 0;
+}
+
+static int assign(struct parser *ps, char *key, size_t key_len, char *value)
+{
+	struct config *c = ps->c;
+	uint16_t koff = key - c->pool;
+	int voff, i, in_section = (c->nentries != 0);
+
+	voff = expand(ps, value);
+	if (voff < 0)
+		return voff;
+
+	if (ps->nvars == MAX_VARS)
+		return CONFIG_ERR_TOOMANY;
+	ps->vars[ps->nvars].key = koff;
+	ps->vars[ps->nvars].key_len = key_len;
+	ps->vars[ps->nvars].value = voff;
+	ps->nvars++;
+	if (!in_section)
+		ps->nglobals = ps->nvars;
+
+	for (i = 0; i < NR_ENTRY_KEYS; i++) {
+		if (!key_is(c, koff, key_len, entry_keys[i]))
+			continue;
+
+		if (in_section)
+			*entry_field(&c->entries[c->nentries - 1], i) = voff;
+		else
+			ps->defaults[i] = voff;
+		return 0;
+	}
+
+	/* Options are only read before the first section */
+	if (in_section)
+		return 0;
+
+	/* The key needs to be terminated, which may cut off the '=' */
+	key[key_len] = '\0';
+	for (i = 0; i < c->noptions; i++) {
+		if (strcmp(c->pool + c->options[i].key, key) == 0) {
+			c->options[i].value = voff;
+			return 0;
+		}
+	}
+
+	if (c->noptions == CONFIG_MAX_OPTIONS)
+		return CONFIG_ERR_TOOMANY;
+	c->options[c->noptions].key = koff;
+	c->options[c->noptions].value = voff;
+	c->noptions++;
+
+	return 0;
+}
+
+/* Parse one line, which has been NUL-terminated in place */
+static int parse_line(struct parser *ps, char *line)
+{
+	char *key, *value, *end;
+	size_t key_len;
+
+	while (is_space(*line))
+		line++;
+
+	if (*line == '\0' || *line == '#' || *line == ';')
+		return 0;
+
+	if (*line == '[') {
+		end = strchr(line, ']');
+		if (!end || end == line + 1)
+			return CONFIG_ERR_SYNTAX;
+		*end = '\0';
+		return new_entry(ps, line + 1);
+	}
+
+	key = line;
+	while (*line && *line != '=' && !is_space(*line))
+		line++;
+	key_len = line - key;
+	while (is_space(*line))
+		line++;
+	if (*line != '=' || key_len == 0)
+		return CONFIG_ERR_SYNTAX;
+	line++;
+
+	while (is_space(*line))
+		line++;
+	value = line;
+	end = value + strlen(value);
+	while (end > value && is_space(end[-1]))
+		*--end = '\0';
+
+	return assign(ps, key, key_len, value);
+}
+
+/*
+ * Parse the len bytes of text at config_text(c). The text is modified.
+ */
+int config_parse(struct config *c, size_t len, const char *sdcard)
+{
+	struct parser ps;
+	char *line, *next;
+	int i, res;
+
+	c->flags = 0;
+	c->nentries = 0;
+	c->noptions = 0;
+	c->error_line = 0;
+
+	if (len > CONFIG_MAX_TEXT)
+		return CONFIG_ERR_TOOBIG;
+
+	c->pool[0] = '\0';
+	c->pool[len + 1] = '\0';
+	c->pool_used = len + 2;
+
+	memset(&ps, 0, sizeof(ps));
+	ps.c = c;
+	ps.sdcard = sdcard;
+
+	for (line = config_text(c); line < c->pool + len + 1; line = next) {
+		ps.line++;
+
+		for (next = line; *next && *next != '\n' && *next != '\r'; next++)
+			;
+		*next++ = '\0';
+
+		res = parse_line(&ps, line);
+		if (res < 0) {
+			c->error_line = ps.line;
+			return res;
+		}
+	}
+
+	/* Old config files describe exactly one entry */
+	if (c->nentries == 0) {
+		c->flags |= CONFIG_LEGACY;
+		c->nentries = 1;
+		res = append(&ps, "default", 8);
+		if (res < 0)
+			return res;
+		c->entries[0].name = c->pool_used - 8;
+		for (i = 0; i < NR_ENTRY_KEYS; i++)
+			*entry_field(&c->entries[0], i) = ps.defaults[i];
+	}
+
+	return 0;
+}
+
+/*
+ * Check that a struct config that didn't come from config_parse (but from a
+ * cache file, say) is safe to use: Every offset must point into the used
+ * part of the pool, which has to end with a NUL.
+ */
+int config_check(const struct config *c)
+{
+	const struct config_entry *e;
+	int i;
+
+	if (c->pool_used < 2 || c->pool_used > CONFIG_POOL_SIZE ||
+	    c->nentries > CONFIG_MAX_ENTRIES ||
+	    c->noptions > CONFIG_MAX_OPTIONS ||
+	    c->pool[c->pool_used - 1] != '\0')
+		return -1;
+
+	for (i = 0; i < c->nentries; i++) {
+		e = &c->entries[i];
+		if (e->name >= c->pool_used || e->kernel >= c->pool_used ||
+		    e->dtb >= c->pool_used || e->initrd >= c->pool_used ||
+		    e->cmdline >= c->pool_used)
+			return -1;
+	}
+
+	for (i = 0; i < c->noptions; i++)
+		if (c->options[i].key >= c->pool_used ||
+		    c->options[i].value >= c->pool_used)
+			return -1;
+
+	return 0;
+}
+
+const char *config_option(const struct config *c, const char *key)
+{
+	int i;
+
+	for (i = 0; i < c->noptions; i++)
+		if (strcmp(c->pool + c->options[i].key, key) == 0)
+			return c->pool + c->options[i].value;
+
+	return NULL;
+}
+
+/* A decimal option. Anything else yields the default. */
+int config_option_int(const struct config *c, const char *key, int def)
+{
+	const char *value = config_option(c, key);
+	int n = 0;
+
+	if (!value || *value == '\0')
+		return def;
+
+	for (; *value; value++) {
+		if (*value < '0' || *value > '9' || n > 100000000)
+			return def;
+		n = n * 10 + (*value - '0');
+	}
+
+	return n;
+}
+
+int config_find_entry(const struct config *c, const char *name)
+{
+	int i;
+
+	for (i = 0; i < c->nentries; i++)
+		if (strcmp(c->pool + c->entries[i].name, name) == 0)
+			return i;
+
+	return -1;
+}
+
+const char *config_strerror(int error)
+{
+	switch (error) {
+	case 0:				return "success";
+	case CONFIG_ERR_TOOBIG:		return "too big";
+	case CONFIG_ERR_TOOMANY:	return "too many entries or variables";
+	case CONFIG_ERR_SYNTAX:		return "syntax error";
+	default:			return "unknown";
+	}
+}
@@ -0,0 +1,117 @@
+/*
+ * Wii U Linux Launcher -- boot configuration parser
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The configuration file (config.txt) looks like this:
+ *
+ *	# Settings before the first section are options, and the defaults
+ *	# for all entries
+ *	default = stable
+ *	dir = ${sdcard}/linux
+ *	dtb = ${dir}/wiiu.dtb
+ *
+ *	[stable]
+ *	kernel = ${dir}/vmlinux-4.14
+ *	cmdline = root=/dev/mmcblk0p2
+ *
+ *	[rc]
+ *	kernel = ${dir}/vmlinux-4.15-rc1
+ *	cmdline = root=/dev/mmcblk0p2 debug
+ *
+ * ${name} expands to the value that name was last set to in the current
+ * section, or before the first section. ${sdcard} is the mount point of the
+ * SD card. $$ is a literal $. A file without sections (as written by older
+ * versions of the launcher) yields a single entry called "default".
+ *
+ * The file is parsed in place: struct config holds the text, and the parsed
+ * strings are NUL-terminated where they are. Only values with variables in
+ * them are copied, to the end of the pool. Everything refers to strings by
+ * their 16-bit offset into the pool, so struct config contains no pointers,
+ * and can be cached as it is (see settings.c).
+ */
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONFIG_MAX_ENTRIES	64
+#define CONFIG_MAX_OPTIONS	32
+#define CONFIG_POOL_SIZE	0x8000
+#define CONFIG_MAX_TEXT		(CONFIG_POOL_SIZE / 2)
+
+/* Errors, always negative. config->error_line says where. */
+#define CONFIG_ERR_TOOBIG	-1
+#define CONFIG_ERR_TOOMANY	-2
+#define CONFIG_ERR_SYNTAX	-3
+
+/* Flags */
+#define CONFIG_LEGACY		0x0001	/* no sections */
+
+struct config_entry {
+	uint16_t name;
+	uint16_t kernel;
+	uint16_t dtb;
+	uint16_t initrd;
+	uint16_t cmdline;
+};
+
+struct config_option {
+	uint16_t key;
+	uint16_t value;
+};
+
+struct config {
+	uint16_t flags;
+	uint16_t nentries;
+	uint16_t noptions;
+	uint16_t pool_used;
+	uint16_t error_line;
+	uint16_t pad;
+
+	struct config_entry entries[CONFIG_MAX_ENTRIES];
+	struct config_option options[CONFIG_MAX_OPTIONS];
+
+	/* pool[0] is the empty string, the text starts at pool[1] */
+	char pool[CONFIG_POOL_SIZE];
+};
+
+/* The part of struct config that is in use */
+#define CONFIG_USED_SIZE(c)	(offsetof(struct config, pool) + (c)->pool_used)
+
+/* Where the text has to be put before calling config_parse */
+static inline char *config_text(struct config *c)
+{
+	return c->pool + 1;
+}
+
+static inline const char *config_str(const struct config *c, uint16_t offset)
+{
+	return c->pool + offset;
+}
+
+extern int config_parse(struct config *c, size_t len, const char *sdcard);
+extern int config_check(const struct config *c);
+extern const char *config_option(const struct config *c, const char *key);
+extern int config_option_int(const struct config *c, const char *key,
+		int def);
+extern int config_find_entry(const struct config *c, const char *name);
+extern const char *config_strerror(int error);
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Wii U Linux Launcher -- ELF program header parsing
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <string.h>
+#include "elf.h"
+
+/* The parts of the ELF32 headers that we look at. Both sides are big endian. */
+struct elf32_ehdr {
+	uint8_t ident[16];
+	uint16_t type;
+	uint16_t machine;
+	uint32_t version;
+	uint32_t entry;
+	uint32_t phoff;
+	uint32_t shoff;
+	uint32_t flags;
+	uint16_t ehsize;
+	uint16_t phentsize;
+	uint16_t phnum;
+	uint16_t shentsize;
+	uint16_t shnum;
+	uint16_t shstrndx;
+};
+
+struct elf32_phdr {
+	uint32_t type;
+	uint32_t offset;
+	uint32_t vaddr;
+	uint32_t paddr;
+	uint32_t filesz;
+	uint32_t memsz;
+	uint32_t flags;
+	uint32_t align;
+};
+
+#define ELFCLASS32	1
+#define ELFDATA2MSB	2
+#define ET_EXEC		2
+#define EM_PPC		20
+#define PT_LOAD		1
+
+/* The headers are big endian, the host build (see host/) might not be */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BE16(x)		__builtin_bswap16(x)
+#define BE32(x)		__builtin_bswap32(x)
+#else
+#define BE16(x)		(x)
+#define BE32(x)		(x)
+#endif
+
+int elf_is_elf(const void *buf, size_t len)
+{
+	return len >= 4 && memcmp(buf, "\177ELF", 4) == 0;
+}
+
+/*
+ * Collect the PT_LOAD segments, and translate the entry point (which is a
+ * virtual address) to a physical address through the segment it lies in.
+ * Empty segments are skipped.
+ */
+int elf_parse(const void *buf, size_t len, struct elf_image *img)
+{
+	const struct elf32_ehdr *ehdr = buf;
+	const struct elf32_phdr *phdr;
+	const uint8_t *p = buf;
+	uint32_t entry, phoff, vaddr;
+	uint16_t phentsize, phnum;
+	struct elf_segment *seg;
+	int i, n = 0, entry_found = 0;
+
+	if (!elf_is_elf(buf, len) || len < sizeof(*ehdr))
+		return ELF_ERR_NOTELF;
+
+	if (ehdr->ident[4] != ELFCLASS32 || ehdr->ident[5] != ELFDATA2MSB ||
+			BE16(ehdr->type) != ET_EXEC || BE16(ehdr->machine) != EM_PPC)
+		return ELF_ERR_UNSUPPORTED;
+
+	entry = BE32(ehdr->entry);
+	phoff = BE32(ehdr->phoff);
+	phentsize = BE16(ehdr->phentsize);
+	phnum = BE16(ehdr->phnum);
+
+	if (phentsize < sizeof(*phdr) || phoff > len ||
+			(len - phoff) / phentsize < phnum)
+		return ELF_ERR_PHDRS;
+
+	for (i = 0; i < phnum; i++) {
+		phdr = (const void *)(p + phoff + i * phentsize);
+		seg = &img->segments[n];
+
+		if (BE32(phdr->type) != PT_LOAD || phdr->memsz == 0)
+			continue;
+		if (n == ELF_MAX_SEGMENTS)
+			return ELF_ERR_TOOMANY;
+
+		seg->offset = BE32(phdr->offset);
+		seg->paddr = BE32(phdr->paddr);
+		seg->filesz = BE32(phdr->filesz);
+		seg->memsz = BE32(phdr->memsz);
+		if (seg->filesz > seg->memsz)
+			return ELF_ERR_PHDRS;
+		n++;
+
+		vaddr = BE32(phdr->vaddr);
+		if (entry - vaddr < seg->memsz) {
+			img->entry = entry - vaddr + seg->paddr;
+			entry_found = 1;
+		}
+	}
+
+	if (!entry_found)
+		return ELF_ERR_ENTRY;
+
+	img->nsegments = n;
+	return 0;
+}
+
+const char *elf_strerror(int error)
+{
+	switch (error) {
+	case 0:			return "success";
+	case ELF_ERR_NOTELF:	return "not an ELF file";
+	case ELF_ERR_UNSUPPORTED: return "not a 32-bit big-endian PowerPC executable";
+	case ELF_ERR_PHDRS:	return "bad program headers";
+	case ELF_ERR_TOOMANY:	return "too many segments";
+	case ELF_ERR_ENTRY:	return "entry point outside of the segments";
+	default:		return "unknown error";
+	}
+}
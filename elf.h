@@ -0,0 +1,57 @@
+/*
+ * Wii U Linux Launcher -- ELF program header parsing
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _ELF_H
+#define _ELF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Errors, always negative */
+#define ELF_ERR_NOTELF		-1
+#define ELF_ERR_UNSUPPORTED	-2
+#define ELF_ERR_PHDRS		-3
+#define ELF_ERR_TOOMANY		-4
+#define ELF_ERR_ENTRY		-5
+
+#define ELF_MAX_SEGMENTS	8
+
+/* A PT_LOAD segment. Everything else in the file is ignored. */
+struct elf_segment {
+	uint32_t offset;	/* where the data starts in the file */
+	uint32_t paddr;		/* where it has to be loaded */
+	uint32_t filesz;	/* how much data there is in the file */
+	uint32_t memsz;		/* filesz, plus the size of the BSS */
+};
+
+struct elf_image {
+	uint32_t entry;		/* physical address of the entry point */
+	int nsegments;
+	struct elf_segment segments[ELF_MAX_SEGMENTS];
+};
+
+/*
+ * buf holds the start of the file. The ELF header and the program headers
+ * must be in the first len bytes.
+ */
+extern int elf_is_elf(const void *buf, size_t len);
+extern int elf_parse(const void *buf, size_t len, struct elf_image *img);
+
+extern const char *elf_strerror(int error);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Wii U Linux Launcher -- Physical extents of buffers
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <os_functions.h>
+#include "extent.h"
+
+static uint32_t phys(const uint8_t *p)
+{
+	return (uint32_t)OSEffectiveToPhysical((void *)p);
+}
+
+/*
+ * Split a buffer into physically contiguous extents. Returns their number,
+ * or -1 if there are more than max. ext may be NULL, to only count them.
+ */
+int extent_walk(const void *buf, size_t size, struct extent *ext, int max)
+{
+	const uint8_t *p = buf, *end = p + size, *next;
+	uint32_t start_phys = 0, expected = 0, page_phys;
+	const uint8_t *start = p;
+	int n = 0;
+
+	for (; p < end; p = next) {
+		next = (const uint8_t *)(((uintptr_t)p + EXTENT_PAGE_SIZE) &
+				~(uintptr_t)(EXTENT_PAGE_SIZE - 1));
+		if (next > end)
+			next = end;
+
+		page_phys = phys(p);
+		if (p == buf) {
+			start_phys = page_phys;
+		} else if (page_phys != expected) {
+			if (n == max)
+				return -1;
+			if (ext) {
+				ext[n].addr = start;
+				ext[n].phys = start_phys;
+				ext[n].size = p - start;
+			}
+			n++;
+			start = p;
+			start_phys = page_phys;
+		}
+		expected = page_phys + (next - p);
+	}
+
+	if (size) {
+		if (n == max)
+			return -1;
+		if (ext) {
+			ext[n].addr = start;
+			ext[n].phys = start_phys;
+			ext[n].size = end - start;
+		}
+		n++;
+	}
+
+	return n;
+}
+
+int extent_is_contiguous(const void *buf, size_t size)
+{
+	int n = extent_walk(buf, size, NULL, 1);
+
+	return n == 0 || n == 1;
+}
@@ -0,0 +1,47 @@
+/*
+ * Wii U Linux Launcher -- Physical extents of buffers
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Nothing guarantees that a buffer that is contiguous in the effective
+ * address space is contiguous in physical memory, too. extent_walk finds
+ * out, by translating each page, and lists the physically contiguous runs.
+ * Whatever is handed to Linux as a whole (the dtb, the initrd) has to be a
+ * single extent; the staged kernel pieces may be scattered, because the
+ * purgatory gathers them with one segment per extent.
+ */
+
+#ifndef _EXTENT_H
+#define _EXTENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The smallest page size, and thus the step in which buffers are checked */
+#define EXTENT_PAGE_SIZE	0x1000
+
+struct extent {
+	const uint8_t *addr;	/* effective */
+	uint32_t phys;
+	uint32_t size;
+};
+
+extern int extent_walk(const void *buf, size_t size, struct extent *ext,
+		int max);
+extern int extent_is_contiguous(const void *buf, size_t size);
+
+#endif
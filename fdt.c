@@ -0,0 +1,521 @@
+/*
+ * Wii U Linux Launcher -- Minimal flattened devicetree editing
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * This only implements what the launcher needs. The format is described in
+ * the devicetree specification, chapter 5 ("Flattened Devicetree (DTB)
+ * Format"). Everything in a blob is big-endian.
+ */
+
+#include <string.h>
+#include "fdt.h"
+
+/* Offsets into the header */
+#define HDR_MAGIC		0x00
+#define HDR_TOTALSIZE		0x04
+#define HDR_OFF_DT_STRUCT	0x08
+#define HDR_OFF_DT_STRINGS	0x0c
+#define HDR_OFF_MEM_RSVMAP	0x10
+#define HDR_VERSION		0x14
+#define HDR_SIZE_DT_STRINGS	0x20
+#define HDR_SIZE_DT_STRUCT	0x24
+
+/* Tokens in the structure block */
+#define FDT_BEGIN_NODE	1
+#define FDT_END_NODE	2
+#define FDT_PROP	3
+#define FDT_NOP		4
+#define FDT_END		9
+
+#define ALIGN4(x)	(((x) + 3) & ~3)
+
+uint32_t fdt_get32(const void *p)
+{
+	const uint8_t *b = p;
+
+	return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 |
+	       (uint32_t)b[2] << 8 | b[3];
+}
+
+void fdt_put32(void *p, uint32_t value)
+{
+	uint8_t *b = p;
+
+	b[0] = value >> 24;
+	b[1] = value >> 16;
+	b[2] = value >> 8;
+	b[3] = value;
+}
+
+static uint32_t hdr(const void *fdt, int field)
+{
+	return fdt_get32((const uint8_t *)fdt + field);
+}
+
+static void set_hdr(void *fdt, int field, uint32_t value)
+{
+	fdt_put32((uint8_t *)fdt + field, value);
+}
+
+static const uint8_t *struct_block(const void *fdt)
+{
+	return (const uint8_t *)fdt + hdr(fdt, HDR_OFF_DT_STRUCT);
+}
+
+static const char *strings_block(const void *fdt)
+{
+	return (const char *)fdt + hdr(fdt, HDR_OFF_DT_STRINGS);
+}
+
+uint32_t fdt_totalsize(const void *fdt)
+{
+	return hdr(fdt, HDR_TOTALSIZE);
+}
+
+/*
+ * Check that the blob is one that we can work with. Apart from the usual
+ * sanity checks, the strings block has to come after the structure block,
+ * because that's what the editing functions assume. dtc always does it this
+ * way.
+ */
+int fdt_check_header(const void *fdt)
+{
+	uint32_t total = hdr(fdt, HDR_TOTALSIZE);
+	uint32_t st = hdr(fdt, HDR_OFF_DT_STRUCT);
+	uint32_t st_size = hdr(fdt, HDR_SIZE_DT_STRUCT);
+	uint32_t str = hdr(fdt, HDR_OFF_DT_STRINGS);
+	uint32_t str_size = hdr(fdt, HDR_SIZE_DT_STRINGS);
+
+	if (hdr(fdt, HDR_MAGIC) != FDT_MAGIC || hdr(fdt, HDR_VERSION) < 17 ||
+	    total < FDT_HEADER_SIZE)
+		return FDT_ERR_BADSTRUCTURE;
+
+	/* Written so that nothing can wrap around */
+	if (st & 3 || st_size & 3 || st_size > total ||
+	    st > total - st_size || st + st_size > str ||
+	    str_size > total || str > total - str_size)
+		return FDT_ERR_BADSTRUCTURE;
+
+	return 0;
+}
+
+/*
+ * Return the offset of the tag after the one at offset, and store the tag at
+ * offset in *tag. Returns a negative error when running off the end.
+ */
+static int next_tag(const void *fdt, int offset, uint32_t *tag)
+{
+	const uint8_t *st = struct_block(fdt);
+	int size = hdr(fdt, HDR_SIZE_DT_STRUCT);
+	uint32_t len;
+
+	if (offset < 0 || offset + 4 > size)
+		return FDT_ERR_BADSTRUCTURE;
+
+	*tag = fdt_get32(st + offset);
+	offset += 4;
+
+	switch (*tag) {
+	case FDT_BEGIN_NODE:
+		while (offset < size && st[offset])
+			offset++;
+		offset = ALIGN4(offset + 1);
+		break;
+	case FDT_PROP:
+		if (offset + 8 > size)
+			return FDT_ERR_BADSTRUCTURE;
+		/* A huge length must not wrap the offset around */
+		len = fdt_get32(st + offset);
+		if (len > (uint32_t)(size - offset - 8))
+			return FDT_ERR_BADSTRUCTURE;
+		offset += 8 + ALIGN4(len);
+		break;
+	case FDT_END_NODE:
+	case FDT_NOP:
+	case FDT_END:
+		break;
+	default:
+		return FDT_ERR_BADSTRUCTURE;
+	}
+
+	return (offset > size)? FDT_ERR_BADSTRUCTURE : offset;
+}
+
+static const char *node_name(const void *fdt, int node)
+{
+	return (const char *)struct_block(fdt) + node + 4;
+}
+
+/* Offset of the first tag after a node's name */
+static int node_body(const void *fdt, int node)
+{
+	uint32_t tag;
+	int offset = next_tag(fdt, node, &tag);
+
+	if (offset >= 0 && tag != FDT_BEGIN_NODE)
+		return FDT_ERR_BADSTRUCTURE;
+
+	return offset;
+}
+
+/*
+ * Find the offset after the last property of a node, i.e. where new
+ * properties or subnodes can be inserted.
+ */
+static int props_end(const void *fdt, int node)
+{
+	int offset = node_body(fdt, node), next;
+	uint32_t tag;
+
+	while (offset >= 0) {
+		next = next_tag(fdt, offset, &tag);
+		if (next < 0)
+			return next;
+		if (tag != FDT_PROP && tag != FDT_NOP)
+			return offset;
+		offset = next;
+	}
+
+	return offset;
+}
+
+/* Does the node name match? "foo" matches "foo" and "foo@1234". */
+static int name_matches(const char *node, const char *name, size_t len)
+{
+	if (strncmp(node, name, len) != 0)
+		return 0;
+
+	return node[len] == '\0' || (node[len] == '@' && !memchr(name, '@', len));
+}
+
+static int subnode_offset_len(const void *fdt, int parent, const char *name,
+		size_t len)
+{
+	int offset = node_body(fdt, parent), next, depth = 0;
+	uint32_t tag;
+
+	while (offset >= 0) {
+		next = next_tag(fdt, offset, &tag);
+		if (next < 0)
+			return next;
+
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			if (depth == 0 &&
+			    name_matches(node_name(fdt, offset), name, len))
+				return offset;
+			depth++;
+			break;
+		case FDT_END_NODE:
+			if (depth-- == 0)
+				return FDT_ERR_NOTFOUND;
+			break;
+		case FDT_END:
+			return FDT_ERR_BADSTRUCTURE;
+		}
+
+		offset = next;
+	}
+
+	return offset;
+}
+
+int fdt_subnode_offset(const void *fdt, int parent, const char *name)
+{
+	return subnode_offset_len(fdt, parent, name, strlen(name));
+}
+
+/* Look up a node by its full path, e.g. "/chosen" */
+int fdt_path_offset(const void *fdt, const char *path)
+{
+	int node = 0;
+
+	while (*path) {
+		const char *end;
+
+		if (*path == '/') {
+			path++;
+			continue;
+		}
+
+		for (end = path; *end && *end != '/'; end++)
+			;
+
+		node = subnode_offset_len(fdt, node, path, end - path);
+		if (node < 0)
+			return node;
+		path = end;
+	}
+
+	return node;
+}
+
+const char *fdt_get_name(const void *fdt, int node)
+{
+	return node_name(fdt, node);
+}
+
+/* Skip NOPs, and return offset if a node starts there */
+static int node_at(const void *fdt, int offset)
+{
+	uint32_t tag;
+	int next;
+
+	while (offset >= 0) {
+		next = next_tag(fdt, offset, &tag);
+		if (next < 0)
+			return next;
+		if (tag == FDT_BEGIN_NODE)
+			return offset;
+		if (tag != FDT_NOP)
+			return FDT_ERR_NOTFOUND;
+		offset = next;
+	}
+
+	return offset;
+}
+
+/*
+ * Iterate over the subnodes of a node:
+ *
+ *	for (node = fdt_first_subnode(fdt, parent); node >= 0;
+ *	     node = fdt_next_subnode(fdt, node))
+ */
+int fdt_first_subnode(const void *fdt, int parent)
+{
+	return node_at(fdt, props_end(fdt, parent));
+}
+
+int fdt_next_subnode(const void *fdt, int node)
+{
+	int offset = node_body(fdt, node), depth = 1;
+	uint32_t tag;
+
+	while (offset >= 0 && depth > 0) {
+		offset = next_tag(fdt, offset, &tag);
+		if (offset < 0)
+			return offset;
+		if (tag == FDT_BEGIN_NODE)
+			depth++;
+		else if (tag == FDT_END_NODE)
+			depth--;
+		else if (tag == FDT_END)
+			return FDT_ERR_BADSTRUCTURE;
+	}
+
+	return node_at(fdt, offset);
+}
+
+/* Whether the string at nameoff in the strings block is name */
+static int prop_name_is(const void *fdt, uint32_t nameoff, const char *name)
+{
+	uint32_t size = hdr(fdt, HDR_SIZE_DT_STRINGS);
+	size_t len = strlen(name);
+
+	/* Only look at bytes within the block, including the NUL */
+	if (nameoff >= size || size - nameoff <= len)
+		return 0;
+
+	return memcmp(strings_block(fdt) + nameoff, name, len + 1) == 0;
+}
+
+/* Find a property in a node. Returns the offset of its FDT_PROP tag. */
+static int prop_offset(const void *fdt, int node, const char *name)
+{
+	const uint8_t *st = struct_block(fdt);
+	int offset = node_body(fdt, node), next;
+	uint32_t tag;
+
+	while (offset >= 0) {
+		next = next_tag(fdt, offset, &tag);
+		if (next < 0)
+			return next;
+		if (tag == FDT_PROP &&
+		    prop_name_is(fdt, fdt_get32(st + offset + 8), name))
+			return offset;
+		if (tag != FDT_PROP && tag != FDT_NOP)
+			return FDT_ERR_NOTFOUND;
+		offset = next;
+	}
+
+	return offset;
+}
+
+const void *fdt_getprop(const void *fdt, int node, const char *name, int *lenp)
+{
+	const uint8_t *st = struct_block(fdt);
+	int offset = prop_offset(fdt, node, name);
+
+	if (offset < 0) {
+		if (lenp)
+			*lenp = offset;
+		return NULL;
+	}
+
+	if (lenp)
+		*lenp = fdt_get32(st + offset + 4);
+
+	return st + offset + 12;
+}
+
+/*
+ * Replace oldlen bytes at offset (in the structure block) with newlen bytes
+ * of uninitialized space, and move everything behind it accordingly.
+ */
+static int splice_struct(void *fdt, size_t bufsize, int offset,
+		int oldlen, int newlen)
+{
+	uint32_t total = fdt_totalsize(fdt);
+	uint8_t *p = (uint8_t *)struct_block(fdt) + offset;
+	uint8_t *end = (uint8_t *)fdt + total;
+	int delta = newlen - oldlen;
+
+	if (total + delta > bufsize)
+		return FDT_ERR_NOSPACE;
+
+	memmove(p + newlen, p + oldlen, end - (p + oldlen));
+
+	set_hdr(fdt, HDR_SIZE_DT_STRUCT, hdr(fdt, HDR_SIZE_DT_STRUCT) + delta);
+	set_hdr(fdt, HDR_OFF_DT_STRINGS, hdr(fdt, HDR_OFF_DT_STRINGS) + delta);
+	set_hdr(fdt, HDR_TOTALSIZE, total + delta);
+
+	return 0;
+}
+
+/* Find a string in the strings block, or append it */
+static int string_offset(void *fdt, size_t bufsize, const char *name)
+{
+	const char *strings = strings_block(fdt);
+	uint32_t size = hdr(fdt, HDR_SIZE_DT_STRINGS);
+	uint32_t total = fdt_totalsize(fdt);
+	uint32_t i, n, len = strlen(name) + 1;
+	const char *end;
+	uint8_t *p;
+
+	/* A last string without a NUL is never looked at */
+	for (i = 0; i < size; i += n + 1) {
+		end = memchr(strings + i, '\0', size - i);
+		if (!end)
+			break;
+		n = end - (strings + i);
+		if (n + 1 == len && memcmp(strings + i, name, len) == 0)
+			return i;
+	}
+
+	if (total + len > bufsize)
+		return FDT_ERR_NOSPACE;
+
+	p = (uint8_t *)strings + size;
+	memmove(p + len, p, (uint8_t *)fdt + total - p);
+	memcpy(p, name, len);
+
+	set_hdr(fdt, HDR_SIZE_DT_STRINGS, size + len);
+	set_hdr(fdt, HDR_TOTALSIZE, total + len);
+
+	return size;
+}
+
+int fdt_setprop(void *fdt, size_t bufsize, int node, const char *name,
+		const void *value, int len)
+{
+	int offset, oldlen, nameoff, res;
+	uint8_t *p;
+
+	/* Add the name first, because it doesn't move the structure block */
+	nameoff = string_offset(fdt, bufsize, name);
+	if (nameoff < 0)
+		return nameoff;
+
+	offset = prop_offset(fdt, node, name);
+	if (offset == FDT_ERR_NOTFOUND) {
+		offset = props_end(fdt, node);
+		oldlen = 0;
+	} else {
+		oldlen = 12 + ALIGN4(fdt_get32(struct_block(fdt) + offset + 4));
+	}
+	if (offset < 0)
+		return offset;
+
+	res = splice_struct(fdt, bufsize, offset, oldlen, 12 + ALIGN4(len));
+	if (res < 0)
+		return res;
+
+	p = (uint8_t *)struct_block(fdt) + offset;
+	fdt_put32(p, FDT_PROP);
+	fdt_put32(p + 4, len);
+	fdt_put32(p + 8, nameoff);
+	memcpy(p + 12, value, len);
+	memset(p + 12 + len, 0, ALIGN4(len) - len);
+
+	return 0;
+}
+
+int fdt_setprop_string(void *fdt, size_t bufsize, int node, const char *name,
+		const char *value)
+{
+	return fdt_setprop(fdt, bufsize, node, name, value, strlen(value) + 1);
+}
+
+int fdt_setprop_cells(void *fdt, size_t bufsize, int node, const char *name,
+		const uint32_t *cells, int count)
+{
+	uint8_t buf[16 * 4];
+	int i;
+
+	if (count > 16)
+		return FDT_ERR_NOSPACE;
+
+	for (i = 0; i < count; i++)
+		fdt_put32(buf + 4 * i, cells[i]);
+
+	return fdt_setprop(fdt, bufsize, node, name, buf, 4 * count);
+}
+
+/* Add an empty subnode to a node, and return its offset */
+int fdt_add_subnode(void *fdt, size_t bufsize, int parent, const char *name)
+{
+	int offset, len = strlen(name) + 1, res;
+	int namelen = ALIGN4(len);
+	uint8_t *p;
+
+	offset = props_end(fdt, parent);
+	if (offset < 0)
+		return offset;
+
+	res = splice_struct(fdt, bufsize, offset, 0, 4 + namelen + 4);
+	if (res < 0)
+		return res;
+
+	p = (uint8_t *)struct_block(fdt) + offset;
+	fdt_put32(p, FDT_BEGIN_NODE);
+	memcpy(p + 4, name, len);
+	memset(p + 4 + len, 0, namelen - len);
+	fdt_put32(p + 4 + namelen, FDT_END_NODE);
+
+	return offset;
+}
+
+const char *fdt_strerror(int error)
+{
+	switch (error) {
+	case FDT_ERR_NOTFOUND:		return "not found";
+	case FDT_ERR_NOSPACE:		return "out of space";
+	case FDT_ERR_BADSTRUCTURE:	return "bad structure";
+	default:			return "unknown";
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * Wii U Linux Launcher -- Minimal flattened devicetree editing
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _FDT_H
+#define _FDT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FDT_MAGIC	0xd00dfeed
+#define FDT_HEADER_SIZE	40	/* of a version 17 header */
+
+/* Errors, always negative */
+#define FDT_ERR_NOTFOUND	-1
+#define FDT_ERR_NOSPACE		-2
+#define FDT_ERR_BADSTRUCTURE	-3
+
+/*
+ * Nodes are identified by their offset into the structure block. The root
+ * node is always at offset 0.
+ *
+ * The functions that modify the blob may move things around, so offsets
+ * should be looked up again after a modification. bufsize is the size of
+ * the buffer that the blob lives in; the blob can grow up to that size.
+ */
+
+extern uint32_t fdt_get32(const void *p);
+extern void fdt_put32(void *p, uint32_t value);
+
+extern int fdt_check_header(const void *fdt);
+extern uint32_t fdt_totalsize(const void *fdt);
+
+extern int fdt_subnode_offset(const void *fdt, int parent, const char *name);
+extern int fdt_path_offset(const void *fdt, const char *path);
+extern const char *fdt_get_name(const void *fdt, int node);
+extern int fdt_first_subnode(const void *fdt, int parent);
+extern int fdt_next_subnode(const void *fdt, int node);
+extern const void *fdt_getprop(const void *fdt, int node, const char *name,
+		int *lenp);
+
+extern int fdt_add_subnode(void *fdt, size_t bufsize, int parent,
+		const char *name);
+extern int fdt_setprop(void *fdt, size_t bufsize, int node, const char *name,
+		const void *value, int len);
+extern int fdt_setprop_string(void *fdt, size_t bufsize, int node,
+		const char *name, const char *value);
+extern int fdt_setprop_cells(void *fdt, size_t bufsize, int node,
+		const char *name, const uint32_t *cells, int count);
+
+extern const char *fdt_strerror(int error);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Wii U Linux Launcher -- FIT (Flattened Image Tree) images
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <string.h>
+#include "fdt.h"
+#include "fit.h"
+
+#define ALIGN4(x)	(((x) + 3) & ~3)
+
+/* Get a string property. Returns NULL if it is missing or not terminated. */
+static const char *get_string(const void *fit, int node, const char *name)
+{
+	const char *str;
+	int len;
+
+	str = fdt_getprop(fit, node, name, &len);
+	if (!str || len < 1 || str[len - 1] != '\0')
+		return NULL;
+
+	return str;
+}
+
+/* Get a one- or two-cell property. For two cells, the upper one is ignored. */
+static int get_u32(const void *fit, int node, const char *name, uint32_t *val)
+{
+	const uint8_t *p;
+	int len;
+
+	p = fdt_getprop(fit, node, name, &len);
+	if (!p || (len != 4 && len != 8))
+		return 0;
+
+	*val = fdt_get32(p + len - 4);
+	return 1;
+}
+
+static int parse_hashes(const void *fit, int node, struct fit_image *img)
+{
+	const void *value;
+	const char *algo;
+	int sub, len, n = 0;
+
+	for (sub = fdt_first_subnode(fit, node); sub >= 0;
+	     sub = fdt_next_subnode(fit, sub)) {
+		if (strncmp(fdt_get_name(fit, sub), "hash", 4) != 0)
+			continue;
+
+		/* Unknown algorithms are skipped */
+		algo = get_string(fit, sub, "algo");
+		if (!algo || hash_algo(algo) == HASH_NONE)
+			continue;
+
+		value = fdt_getprop(fit, sub, "value", &len);
+		if (!value || len != hash_size(hash_algo(algo)))
+			return FIT_ERR_BADIMAGE;
+
+		if (n == FIT_MAX_HASHES)
+			break;
+
+		img->hashes[n].algo = hash_algo(algo);
+		memcpy(img->hashes[n].value, value, len);
+		n++;
+	}
+
+	if (sub < 0 && sub != FDT_ERR_NOTFOUND)
+		return sub;
+
+	img->nhashes = n;
+	return 0;
+}
+
+/* Look up the image that a configuration refers to in the property prop */
+static int parse_image(const void *fit, int conf, const char *prop,
+		struct fit_image *img)
+{
+	const char *name, *compression;
+	uint32_t offset;
+	int images, node;
+
+	memset(img, 0, sizeof(*img));
+
+	name = get_string(fit, conf, prop);
+	if (!name)
+		return 0;
+
+	images = fdt_path_offset(fit, "/images");
+	if (images < 0)
+		return images;
+
+	node = fdt_subnode_offset(fit, images, name);
+	if (node < 0)
+		return (node == FDT_ERR_NOTFOUND)? FIT_ERR_NOIMAGE : node;
+
+	if (fdt_getprop(fit, node, "data", NULL))
+		return FIT_ERR_EMBEDDED;
+
+	compression = get_string(fit, node, "compression");
+	if (compression && strcmp(compression, "none") != 0)
+		return FIT_ERR_COMPRESSED;
+
+	/* data-offset is relative to the end of the devicetree */
+	if (get_u32(fit, node, "data-position", &offset))
+		img->offset = offset;
+	else if (get_u32(fit, node, "data-offset", &offset))
+		img->offset = ALIGN4(fdt_totalsize(fit)) + offset;
+	else
+		return FIT_ERR_BADIMAGE;
+
+	if (!get_u32(fit, node, "data-size", &img->size))
+		return FIT_ERR_BADIMAGE;
+
+	img->has_load = get_u32(fit, node, "load", &img->load);
+	img->has_entry = get_u32(fit, node, "entry", &img->entry);
+	img->present = 1;
+
+	return parse_hashes(fit, node, img);
+}
+
+int fit_parse(const void *fit, const char *config, struct fit_config *cfg)
+{
+	int confs, conf, res;
+
+	res = fdt_check_header(fit);
+	if (res < 0)
+		return res;
+
+	confs = fdt_path_offset(fit, "/configurations");
+	if (confs < 0)
+		return FIT_ERR_NOCONFIG;
+
+	if (!config || config[0] == '\0')
+		config = get_string(fit, confs, "default");
+	if (!config)
+		return FIT_ERR_NOCONFIG;
+
+	conf = fdt_subnode_offset(fit, confs, config);
+	if (conf < 0)
+		return FIT_ERR_NOCONFIG;
+
+	res = parse_image(fit, conf, "kernel", &cfg->kernel);
+	if (res < 0)
+		return res;
+	if (!cfg->kernel.present)
+		return FIT_ERR_NOIMAGE;
+
+	res = parse_image(fit, conf, "fdt", &cfg->fdt);
+	if (res < 0)
+		return res;
+
+	return parse_image(fit, conf, "ramdisk", &cfg->ramdisk);
+}
+
+const char *fit_strerror(int error)
+{
+	switch (error) {
+	case FIT_ERR_NOCONFIG:		return "configuration not found";
+	case FIT_ERR_NOIMAGE:		return "image not found";
+	case FIT_ERR_EMBEDDED:		return "embedded data (build it with mkimage -E)";
+	case FIT_ERR_COMPRESSED:	return "compressed images are not supported";
+	case FIT_ERR_BADIMAGE:		return "bad image node";
+	default:			return fdt_strerror(error);
+	}
+}
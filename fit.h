@@ -0,0 +1,74 @@
+/*
+ * Wii U Linux Launcher -- FIT (Flattened Image Tree) images
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * A FIT image is a devicetree blob that describes a number of images
+ * (kernels, dtbs, ramdisks), and configurations that combine them. See
+ * doc/uImage.FIT/ in the U-Boot source tree.
+ *
+ * Only FIT images with external data (mkimage -E) are supported: The
+ * devicetree at the start of the file is small, and the images can be read
+ * straight from the file, without reading the rest of it.
+ */
+
+#ifndef _FIT_H
+#define _FIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash.h"
+
+/* Errors, always negative. Errors from fdt.h may be returned as well. */
+#define FIT_ERR_NOCONFIG	-16
+#define FIT_ERR_NOIMAGE		-17
+#define FIT_ERR_EMBEDDED	-18
+#define FIT_ERR_COMPRESSED	-19
+#define FIT_ERR_BADIMAGE	-20
+
+#define FIT_MAX_HASHES	2
+
+struct fit_image {
+	int present;
+	uint32_t offset;	/* where the data starts in the file */
+	uint32_t size;
+	int has_load, has_entry;
+	uint32_t load, entry;
+
+	int nhashes;
+	struct {
+		int algo;
+		uint8_t value[HASH_MAX_SIZE];
+	} hashes[FIT_MAX_HASHES];
+};
+
+struct fit_config {
+	struct fit_image kernel;
+	struct fit_image fdt;
+	struct fit_image ramdisk;
+};
+
+/*
+ * The devicetree has to be read completely. config selects a
+ * configuration by name; if it is NULL or empty, the default configuration
+ * is used.
+ */
+extern int fit_parse(const void *fit, const char *config, struct fit_config *cfg);
+
+extern const char *fit_strerror(int error);
+
+#endif
@@ -21,6 +21,7 @@
 #include <string.h>
 #include "main.h"
 #include "fs.h"
+#include "trace.h"
 
 #define FS_BUFFER_SIZE 4096
 static FSClient *fs_client;
@@ -54,6 +55,7 @@ const char *FS_strerror(int error)
 		case  0: return "success";
 		case -6: return "file not found";
 		case -7: return "not a file";
+		case -12: return "storage full";
 		default: return "unknown";
 	}
 }
@@ -112,22 +114,19 @@ size_t get_file_size(const char *filename, const char *what)
 	return stat.size;
 }
 
-#define MIN(a, b) (((a) < (b))? (a) : (b))
-int read_file_into_buffer(const char *filename, u8 *buffer, size_t size,
-		const char *what)
+/* Like get_file_size, but quiet, and with all the details */
+int fs_stat(const char *filename, FSStat *stat)
 {
-	s32 res, handle;
-	size_t bytes_read = 0, chunk_size;
-
-	if (filename[0] == '\0')
-		return 0;
+	FSInitCmdBlock(fs_cmdblock);
+	return FSGetStat(fs_client, fs_cmdblock, filename, stat, -1);
+}
 
-	if (what) {
-		warnf("Loading %s...", what);
-		draw_gui();
-	}
+#define MIN(a, b) (((a) < (b))? (a) : (b))
 
-	memset(buffer, 0, size);
+/* Open a file for reading. Returns the handle, or a negative error code. */
+int fs_open_file(const char *filename, const char *what)
+{
+	s32 res, handle;
 
 	res = FSOpenFile(fs_client, fs_cmdblock, filename, "r", &handle, -1);
 	if (res < 0) {
@@ -137,63 +136,325 @@ int read_file_into_buffer(const char *filename, u8 *buffer, size_t size,
 		return res;
 	}
 
+	return handle;
+}
+
+void fs_close_file(int handle)
+{
+	FSCloseFile(fs_client, fs_cmdblock, handle, -1);
+}
+
+/* The most that is read with one FSReadFileWithPos call */
+#define FS_DIRECT_CHUNK	0x100000
+
+/*
+ * Read size bytes at offset pos of an open file. Returns the number of bytes
+ * read, which is only less than size at the end of the file, or a negative
+ * error code.
+ *
+ * NOTE: If the buffer passed to FSReadFile isn't aligned to a 0x40 byte
+ * boundary, FSReadFile will hang! The part of the target buffer that is
+ * properly aligned is read into directly, in big chunks. Only the unaligned
+ * start and the last few bytes go through fs_buffer.
+ */
+int fs_read_at(int handle, u8 *buffer, size_t size, uint32_t pos,
+		const char *what)
+{
+	size_t bytes_read = 0, chunk_size;
+	u8 *dest;
+	s32 res;
+
 	while (bytes_read < size) {
-		/*
-		 * NOTE: If the buffer passed to FSReadFile isn't aligned to a
-		 * 0x40 byte boundary, FSReadFile will hang! Because of this, I
-		 * read the data into an aligned buffer first, and then copy it
-		 * into the target buffer.
-		 */
+		dest = buffer + bytes_read;
 
-		chunk_size = MIN(size - bytes_read, FS_BUFFER_SIZE);
-		res = FSReadFile(fs_client, fs_cmdblock, fs_buffer,
-				1, chunk_size, handle, 0, -1);
+		if ((uintptr_t)dest % FS_IO_BUFFER_ALIGN == 0 &&
+				size - bytes_read >= FS_IO_BUFFER_ALIGN) {
+			chunk_size = MIN(size - bytes_read, FS_DIRECT_CHUNK);
+			chunk_size -= chunk_size % FS_IO_BUFFER_ALIGN;
+			res = FSReadFileWithPos(fs_client, fs_cmdblock, dest,
+					1, chunk_size, pos + bytes_read,
+					handle, 0, -1);
+		} else {
+			chunk_size = MIN(size - bytes_read, FS_BUFFER_SIZE);
+			if ((uintptr_t)dest % FS_IO_BUFFER_ALIGN)
+				chunk_size = MIN(chunk_size, FS_IO_BUFFER_ALIGN -
+					(uintptr_t)dest % FS_IO_BUFFER_ALIGN);
+			res = FSReadFileWithPos(fs_client, fs_cmdblock,
+					fs_buffer, 1, chunk_size,
+					pos + bytes_read, handle, 0, -1);
+			if (res > 0)
+				memcpy(dest, fs_buffer, res);
+		}
 
 		if (res < 0) {
 			if (what)
-				warnf("Reading from %s failed: %s (%d)",
+				warnf("Reading from %s failed: %s (%d)", what,
 						FS_strerror(res), res);
-			FSCloseFile(fs_client, fs_cmdblock, handle, -1);
 			return res;
 		} else if (res == 0) {
 			break;
-		} else {
-			memcpy(buffer + bytes_read, fs_buffer, res);
-			bytes_read += res;
 		}
+
+		bytes_read += res;
 	}
 
-	FSCloseFile(fs_client, fs_cmdblock, handle, -1);
+	return bytes_read;
+}
+
+int read_file_into_buffer(const char *filename, u8 *buffer, size_t size,
+		const char *what)
+{
+	int res, handle;
+
+	TRACE_FUNC();
+
+	if (filename[0] == '\0')
+		return 0;
+
+	if (what) {
+		warnf("Loading %s...", what);
+		draw_gui();
+	}
+
+	handle = fs_open_file(filename, what);
+	if (handle < 0)
+		return handle;
+
+	res = fs_read_at(handle, buffer, size, 0, what);
+	fs_close_file(handle);
+	if (res < 0)
+		return res;
+
+	memset(buffer + res, 0, size - res);
 	if (what)
 		warn("");
 
-	return bytes_read;
+	return res;
+}
+
+/* What a short write is reported as */
+#ifndef FS_STATUS_STORAGE_FULL
+#define FS_STATUS_STORAGE_FULL	-12
+#endif
+
+/*
+ * Write a buffer at the current position of a file. Returns the number of
+ * bytes written, or a negative error code.
+ *
+ * Like fs_read_at, this writes directly from the part of the buffer that is
+ * aligned, in big chunks, and only copies the rest through fs_buffer.
+ */
+static int fs_write_all(int handle, const u8 *buffer, size_t size)
+{
+	size_t bytes_written = 0, chunk_size;
+	const u8 *src;
+	s32 res;
+
+	while (bytes_written < size) {
+		src = buffer + bytes_written;
+
+		if ((uintptr_t)src % FS_IO_BUFFER_ALIGN == 0 &&
+				size - bytes_written >= FS_IO_BUFFER_ALIGN) {
+			chunk_size = MIN(size - bytes_written, FS_DIRECT_CHUNK);
+			chunk_size -= chunk_size % FS_IO_BUFFER_ALIGN;
+			res = FSWriteFile(fs_client, fs_cmdblock, (void *)src,
+					1, chunk_size, handle, 0, -1);
+		} else {
+			chunk_size = MIN(size - bytes_written, FS_BUFFER_SIZE);
+			if ((uintptr_t)src % FS_IO_BUFFER_ALIGN)
+				chunk_size = MIN(chunk_size, FS_IO_BUFFER_ALIGN -
+					(uintptr_t)src % FS_IO_BUFFER_ALIGN);
+			memcpy(fs_buffer, src, chunk_size);
+			res = FSWriteFile(fs_client, fs_cmdblock, fs_buffer,
+					1, chunk_size, handle, 0, -1);
+		}
+
+		if (res < 0)
+			return res;
+		else if (res == 0)
+			break;
+
+		bytes_written += res;
+	}
+
+	return bytes_written;
 }
 
 int write_buffer_into_file(const char *filename, u8 *buffer, size_t size)
 {
 	s32 res, handle;
-	size_t bytes_written = 0;
 
+	FSInitCmdBlock(fs_cmdblock);
 	res = FSOpenFile(fs_client, fs_cmdblock, filename, "w", &handle, -1);
 	if (res < 0)
 		return res;
 
-	while (bytes_written < size) {
-		size_t chunk_size = MIN(FS_BUFFER_SIZE, size - bytes_written);
+	res = fs_write_all(handle, buffer, size);
+	FSCloseFile(fs_client, fs_cmdblock, handle, -1);
+
+	return res;
+}
+
+/*
+ * A writer collects small writes in a big buffer, so that the file is
+ * written in a few large chunks. Big aligned writes go straight to the file
+ * when nothing is buffered.
+ */
+int fs_writer_open(struct fs_writer *w, const char *filename)
+{
+	s32 res;
+
+	w->used = 0;
+	w->written = 0;
+	w->error = 0;
+
+	FSInitCmdBlock(fs_cmdblock);
+	res = FSOpenFile(fs_client, fs_cmdblock, filename, "w", &w->handle, -1);
+	if (res < 0)
+		return res;
+
+	w->buffer = xmalloc(FS_WRITER_BUFFER_SIZE, FS_IO_BUFFER_ALIGN);
+	return 0;
+}
+
+static int fs_writer_commit(struct fs_writer *w, const u8 *data, size_t size)
+{
+	int res = fs_write_all(w->handle, data, size);
+
+	if (res >= 0)
+		w->written += res;
+	if (res >= 0 && res != size)
+		res = FS_STATUS_STORAGE_FULL;
+	if (res < 0)
+		w->error = res;
+
+	return res;
+}
+
+int fs_writer_flush(struct fs_writer *w)
+{
+	int res;
+
+	if (w->error || w->used == 0)
+		return w->error;
+
+	res = fs_writer_commit(w, w->buffer, w->used);
+	w->used = 0;
+	return (res < 0)? res : 0;
+}
+
+int fs_writer_write(struct fs_writer *w, const void *data, size_t size)
+{
+	const u8 *p = data;
+	size_t n;
+	int res;
+
+	while (size && !w->error) {
+		if (w->used == 0 && (uintptr_t)p % FS_IO_BUFFER_ALIGN == 0 &&
+				size >= FS_WRITER_BUFFER_SIZE) {
+			n = size - size % FS_IO_BUFFER_ALIGN;
+			res = fs_writer_commit(w, p, n);
+		} else {
+			n = MIN(size, FS_WRITER_BUFFER_SIZE - w->used);
+			memcpy(w->buffer + w->used, p, n);
+			w->used += n;
+			res = (w->used == FS_WRITER_BUFFER_SIZE)?
+				fs_writer_flush(w) : 0;
+		}
 
-		memcpy(fs_buffer, buffer + bytes_written, chunk_size);
-		res = FSWriteFile(fs_client, fs_cmdblock, fs_buffer,
-				1, size - bytes_written, handle, 0, -1);
 		if (res < 0)
 			return res;
-		else if (res == 0)
-			break;
-		else
-			bytes_written += res;
+		p += n;
+		size -= n;
 	}
 
+	return w->error;
+}
+
+/* Returns the size of the file, or the first error that happened. Only for
+ * writers that were opened successfully. */
+int fs_writer_close(struct fs_writer *w)
+{
+	fs_writer_flush(w);
+	FSCloseFile(fs_client, fs_cmdblock, w->handle, -1);
+	xfree(w->buffer);
+
+	return w->error? w->error : (int)w->written;
+}
+
+static void get_tmp_path(char *buf, size_t size, const char *filename)
+{
+	snprintf(buf, size, "%s.tmp", filename);
+}
+
+/*
+ * Replace a file without ever leaving a partially written one behind: The
+ * data goes to filename.tmp first, which is then renamed. If the power goes
+ * out between removing the old file and the rename, fs_recover_file finishes
+ * the job.
+ */
+int fs_replace_file(const char *filename, u8 *buffer, size_t size)
+{
+	char tmp[300];
+	s32 res;
+
+	get_tmp_path(tmp, sizeof tmp, filename);
+	res = write_buffer_into_file(tmp, buffer, size);
+	if (res < 0)
+		return res;
+	if (res != size)
+		return -1;
+
+	/* FSRename doesn't replace existing files */
+	FSInitCmdBlock(fs_cmdblock);
+	FSRemove(fs_client, fs_cmdblock, filename, -1);
+	return FSRename(fs_client, fs_cmdblock, tmp, filename, -1);
+}
+
+/* Clean up after an interrupted fs_replace_file */
+void fs_recover_file(const char *filename)
+{
+	char tmp[300];
+	FSStat stat;
+
+	get_tmp_path(tmp, sizeof tmp, filename);
+	if (fs_stat(tmp, &stat) < 0)
+		return;
+
+	/* If the old file is still there, the new one may be incomplete */
+	FSInitCmdBlock(fs_cmdblock);
+	if (fs_stat(filename, &stat) >= 0)
+		FSRemove(fs_client, fs_cmdblock, tmp, -1);
+	else
+		FSRename(fs_client, fs_cmdblock, tmp, filename, -1);
+}
+
+/*
+ * Overwrite the start of a file (creating it if necessary) with one write,
+ * without truncating it first. When size is at most a sector, and the file
+ * already exists, that's a single sector write on the card.
+ */
+int fs_overwrite_file(const char *filename, const u8 *buffer, size_t size)
+{
+	s32 res, handle;
+
+	if (size > FS_BUFFER_SIZE)
+		return -1;
+
+	FSInitCmdBlock(fs_cmdblock);
+	res = FSOpenFile(fs_client, fs_cmdblock, filename, "r+", &handle, -1);
+	if (res < 0)
+		res = FSOpenFile(fs_client, fs_cmdblock, filename, "w",
+				&handle, -1);
+	if (res < 0)
+		return res;
+
+	memcpy(fs_buffer, buffer, size);
+	res = FSWriteFile(fs_client, fs_cmdblock, fs_buffer, 1, size,
+			handle, 0, -1);
 	FSCloseFile(fs_client, fs_cmdblock, handle, -1);
 
-	return bytes_written;
+	if (res >= 0 && res != size)
+		return -1;
+	return res;
 }
@@ -20,6 +20,7 @@
 #define _FS_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <fs_defs.h>
 
 extern char sdcard_path[FS_MAX_MOUNTPATH_SIZE];
@@ -31,8 +32,34 @@ extern const char *FS_strerror(int error);
 extern void mount_sdcard(void);
 extern void unmount_sdcard(void);
 extern size_t get_file_size(const char *filename, const char *what);
+extern int fs_stat(const char *filename, FSStat *stat);
+extern int fs_open_file(const char *filename, const char *what);
+extern void fs_close_file(int handle);
+extern int fs_read_at(int handle, u8 *buffer, size_t size, uint32_t pos,
+		const char *what);
 extern int read_file_into_buffer(const char *filename, u8 *buffer, size_t size,
 		const char *what);
 extern int write_buffer_into_file(const char *filename, u8 *buffer, size_t size);
 
+/* See fs_writer_open */
+#define FS_WRITER_BUFFER_SIZE	0x40000
+
+struct fs_writer {
+	int handle;
+	u8 *buffer;
+	size_t used;
+	uint32_t written;
+	int error;
+};
+
+extern int fs_writer_open(struct fs_writer *w, const char *filename);
+extern int fs_writer_write(struct fs_writer *w, const void *data, size_t size);
+extern int fs_writer_flush(struct fs_writer *w);
+extern int fs_writer_close(struct fs_writer *w);
+
+extern int fs_replace_file(const char *filename, u8 *buffer, size_t size);
+extern void fs_recover_file(const char *filename);
+extern int fs_overwrite_file(const char *filename, const u8 *buffer,
+		size_t size);
+
 #endif
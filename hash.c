@@ -0,0 +1,208 @@
+/*
+ * Wii U Linux Launcher -- checksums and hashes for verifying images
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <string.h>
+#include "hash.h"
+
+int hash_algo(const char *name)
+{
+	if (strcmp(name, "crc32") == 0)
+		return HASH_CRC32;
+	if (strcmp(name, "sha1") == 0)
+		return HASH_SHA1;
+	return HASH_NONE;
+}
+
+int hash_size(int algo)
+{
+	switch (algo) {
+	case HASH_CRC32:	return 4;
+	case HASH_SHA1:		return 20;
+	default:		return 0;
+	}
+}
+
+/*
+ * CRC-32, as in zlib. The table is computed on first use.
+ */
+static uint32_t crc_table[256];
+
+static void crc32_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1)? (c >> 1) ^ 0xedb88320 : c >> 1;
+		crc_table[i] = c;
+	}
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len)
+{
+	crc = ~crc;
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+/*
+ * SHA-1, as in FIPS 180-4
+ */
+#define ROL(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(uint32_t *h, const uint8_t *block)
+{
+	uint32_t w[80], a, b, c, d, e, f, k, t;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = (uint32_t)block[4 * i] << 24 |
+		       (uint32_t)block[4 * i + 1] << 16 |
+		       (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+	for (; i < 80; i++)
+		w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+	a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4];
+
+	for (i = 0; i < 80; i++) {
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		t = ROL(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROL(b, 30);
+		b = a;
+		a = t;
+	}
+
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+void hash_init(struct hash *h, int algo)
+{
+	static const uint32_t sha1_init[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+	};
+
+	h->algo = algo;
+
+	switch (algo) {
+	case HASH_CRC32:
+		if (crc_table[1] == 0)
+			crc32_init();
+		h->u.crc = 0;
+		break;
+	case HASH_SHA1:
+		memcpy(h->u.sha1.h, sha1_init, sizeof(sha1_init));
+		h->u.sha1.len_lo = h->u.sha1.len_hi = 0;
+		h->u.sha1.used = 0;
+		break;
+	}
+}
+
+void hash_update(struct hash *h, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t n;
+
+	switch (h->algo) {
+	case HASH_CRC32:
+		h->u.crc = crc32_update(h->u.crc, p, len);
+		break;
+	case HASH_SHA1:
+		if (h->u.sha1.len_lo + len < h->u.sha1.len_lo)
+			h->u.sha1.len_hi++;
+		h->u.sha1.len_lo += len;
+
+		while (len) {
+			if (h->u.sha1.used == 0 && len >= 64) {
+				sha1_block(h->u.sha1.h, p);
+				p += 64;
+				len -= 64;
+				continue;
+			}
+
+			n = 64 - h->u.sha1.used;
+			if (n > len)
+				n = len;
+			memcpy(h->u.sha1.block + h->u.sha1.used, p, n);
+			h->u.sha1.used += n;
+			p += n;
+			len -= n;
+
+			if (h->u.sha1.used == 64) {
+				sha1_block(h->u.sha1.h, h->u.sha1.block);
+				h->u.sha1.used = 0;
+			}
+		}
+		break;
+	}
+}
+
+static void put_be32(uint8_t *p, uint32_t x)
+{
+	p[0] = x >> 24;
+	p[1] = x >> 16;
+	p[2] = x >> 8;
+	p[3] = x;
+}
+
+/* Write the digest, in the byte order that mkimage stores it in */
+void hash_final(struct hash *h, uint8_t *digest)
+{
+	uint32_t hi, lo;
+	uint8_t pad[72];
+	size_t padlen;
+	int i;
+
+	switch (h->algo) {
+	case HASH_CRC32:
+		put_be32(digest, h->u.crc);
+		break;
+	case HASH_SHA1:
+		hi = h->u.sha1.len_hi << 3 | h->u.sha1.len_lo >> 29;
+		lo = h->u.sha1.len_lo << 3;
+
+		padlen = (h->u.sha1.used < 56)? 56 - h->u.sha1.used :
+						 120 - h->u.sha1.used;
+		memset(pad, 0, sizeof(pad));
+		pad[0] = 0x80;
+		put_be32(pad + padlen, hi);
+		put_be32(pad + padlen + 4, lo);
+		hash_update(h, pad, padlen + 8);
+
+		for (i = 0; i < 5; i++)
+			put_be32(digest + 4 * i, h->u.sha1.h[i]);
+		break;
+	}
+}
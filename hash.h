@@ -0,0 +1,52 @@
+/*
+ * Wii U Linux Launcher -- checksums and hashes for verifying images
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _HASH_H
+#define _HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH_NONE	0
+#define HASH_CRC32	1
+#define HASH_SHA1	2
+
+#define HASH_MAX_SIZE	20
+
+struct hash {
+	int algo;
+	union {
+		uint32_t crc;
+		struct {
+			uint32_t h[5];
+			uint32_t len_lo, len_hi;
+			uint8_t block[64];
+			int used;
+		} sha1;
+	} u;
+};
+
+/* Look up an algorithm by the name that mkimage uses */
+extern int hash_algo(const char *name);
+extern int hash_size(int algo);
+
+extern void hash_init(struct hash *h, int algo);
+extern void hash_update(struct hash *h, const void *data, size_t len);
+extern void hash_final(struct hash *h, uint8_t *digest);
+
+#endif
@@ -16,10 +16,12 @@
  * with this program, in the file LICENSE.GPLv2.
  */
 
+#include <string.h>
 #include <os_functions.h>
 #include "fs.h"
 #include "hax.h"
 #include "main.h"
+#include "trace.h"
 
 /* Open /dev/iosuhax and return an FD or an error (negative) */
 int iosuhax_open(void)
@@ -50,6 +52,13 @@ void iosuhax_close(int fd)
 #define IOCTL_KERN_READ32           0x06
 #define IOCTL_KERN_WRITE32          0x07
 
+#define IOCTL_FSA_OPEN              0x40
+#define IOCTL_FSA_CLOSE             0x41
+#define IOCTL_FSA_OPENFILE          0x49
+#define IOCTL_FSA_READFILE          0x4A
+#define IOCTL_FSA_STATFILE          0x4C
+#define IOCTL_FSA_CLOSEFILE         0x4D
+
 /* Perform syscall 0x81, the iosuhax kernel backdoor */
 static int iosuhax_svc81(int fd, uint32_t command, int arg1, int arg2, int arg3)
 {
@@ -86,9 +95,19 @@ uint32_t iosuhax_kern_read32(int fd, uint32_t address)
 
 int iosuhax_kern_write32(int fd, uint32_t address, uint32_t value)
 {
+	TRACE_FUNC();
+
 	return iosuhax_svc81(fd, KERNEL_WRITE32, address, value, 0);
 }
 
+/* Copy size bytes between physical addresses */
+int iosuhax_kern_memcpy(int fd, uint32_t dst, uint32_t src, uint32_t size)
+{
+	TRACE_FUNC();
+
+	return iosuhax_svc81(fd, KERNEL_MEMCPY, dst, src, size);
+}
+
 void iosuhax_kern_write_buf(int fd, uint32_t dst, const void *src, size_t size)
 {
 	size_t i;
@@ -112,3 +131,102 @@ void iosuhax_svc_0x53(int fd, uint32_t addr)
 	IOS_Ioctl(fd, IOCTL_SVC, req_buf, sizeof req_buf, resp_buf,
 			sizeof resp_buf);
 }
+
+/*
+ * IOSU's filesystem access, through iosuhax. This reaches devices that the
+ * PPC's FS library doesn't, like the MLC (/vol/storage_mlc01). Each function
+ * returns a negative error, as IOSU reports it, on failure.
+ */
+int iosuhax_fsa_open(int fd)
+{
+	int ret, fsa;
+
+	ret = IOS_Ioctl(fd, IOCTL_FSA_OPEN, NULL, 0, &fsa, sizeof fsa);
+	if (ret < 0)
+		return ret;
+
+	return fsa;
+}
+
+void iosuhax_fsa_close(int fd, int fsa)
+{
+	int resp_buf[1];
+
+	IOS_Ioctl(fd, IOCTL_FSA_CLOSE, &fsa, sizeof fsa, resp_buf,
+			sizeof resp_buf);
+}
+
+/* Open a file for reading, and return its handle */
+int iosuhax_fsa_open_file(int fd, int fsa, const char *path)
+{
+	size_t len = strlen(path) + 1;
+	int *req_buf;
+	int resp_buf[2];
+	int ret;
+
+	/* The FSA FD, and where the path and the mode are, followed by both */
+	req_buf = xmalloc(3 * 4 + len + 2, 0x40);
+	req_buf[0] = fsa;
+	req_buf[1] = 3 * 4;
+	req_buf[2] = 3 * 4 + len;
+	memcpy((char *)req_buf + 3 * 4, path, len);
+	memcpy((char *)req_buf + 3 * 4 + len, "r", 2);
+
+	ret = IOS_Ioctl(fd, IOCTL_FSA_OPENFILE, req_buf, 3 * 4 + len + 2,
+			resp_buf, sizeof resp_buf);
+	xfree(req_buf);
+	if (ret < 0)
+		return ret;
+	if (resp_buf[0] < 0)
+		return resp_buf[0];
+
+	return resp_buf[1];
+}
+
+/* The size of an open file */
+int iosuhax_fsa_file_size(int fd, int fsa, int handle, uint32_t *size)
+{
+	int req_buf[2] = { fsa, handle };
+	int resp_buf[1 + 0x64 / 4];
+	int ret;
+
+	ret = IOS_Ioctl(fd, IOCTL_FSA_STATFILE, req_buf, sizeof req_buf,
+			resp_buf, sizeof resp_buf);
+	if (ret < 0)
+		return ret;
+	if (resp_buf[0] < 0)
+		return resp_buf[0];
+
+	/* The size is at offset 0x10 in the stat data */
+	*size = resp_buf[1 + 4];
+	return 0;
+}
+
+/*
+ * Read up to size bytes from the current position, and return how many were
+ * read. IOSU puts its result in front of the data: buf has to be 0x40-aligned,
+ * with room for IOSUHAX_FSA_READ_OFFSET + size bytes, and the data ends up at
+ * buf + IOSUHAX_FSA_READ_OFFSET.
+ */
+int iosuhax_fsa_read_file(int fd, int fsa, int handle, void *buf,
+		uint32_t size)
+{
+	int req_buf[5] = { fsa, 1, size, handle, 0 };
+	int ret;
+
+	ret = IOS_Ioctl(fd, IOCTL_FSA_READFILE, req_buf, sizeof req_buf, buf,
+			IOSUHAX_FSA_READ_OFFSET + size);
+	if (ret < 0)
+		return ret;
+
+	return *(int *)buf;
+}
+
+void iosuhax_fsa_close_file(int fd, int fsa, int handle)
+{
+	int req_buf[2] = { fsa, handle };
+	int resp_buf[1];
+
+	IOS_Ioctl(fd, IOCTL_FSA_CLOSEFILE, req_buf, sizeof req_buf, resp_buf,
+			sizeof resp_buf);
+}
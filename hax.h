@@ -26,7 +26,20 @@ extern void iosuhax_close(int fd);
 
 extern uint32_t iosuhax_kern_read32(int fd, uint32_t address);
 extern int iosuhax_kern_write32(int fd, uint32_t address, uint32_t value);
+extern int iosuhax_kern_memcpy(int fd, uint32_t dst, uint32_t src,
+		uint32_t size);
 extern void iosuhax_kern_write_buf(int fd, uint32_t dst, const void *src, size_t size);
 extern void iosuhax_svc_0x53(int fd, uint32_t addr);
 
+/* Where iosuhax_fsa_read_file puts the data in its buffer */
+#define IOSUHAX_FSA_READ_OFFSET	0x40
+
+extern int iosuhax_fsa_open(int fd);
+extern void iosuhax_fsa_close(int fd, int fsa);
+extern int iosuhax_fsa_open_file(int fd, int fsa, const char *path);
+extern int iosuhax_fsa_file_size(int fd, int fsa, int handle, uint32_t *size);
+extern int iosuhax_fsa_read_file(int fd, int fsa, int handle, void *buf,
+		uint32_t size);
+extern void iosuhax_fsa_close_file(int fd, int fsa, int handle);
+
 #endif
@@ -0,0 +1,354 @@
+/*
+ * Wii U Linux Launcher -- Host build: the filesystem, backed by a directory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * /vol/external01 (the SD card) is the directory named by HOST_SDCARD
+ * ("sdcard" by default). How long each call takes is up to the SD card model
+ * in sdcard.c. With HOST_FS_STATS set, what the card did is printed on exit.
+ *
+ * Like on the console, file I/O has to use buffers aligned to
+ * FS_IO_BUFFER_ALIGN. FSReadFile would hang otherwise; here, it's fatal.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <os_functions.h>
+#include <fs_functions.h>
+#include "host.h"
+
+#define SDCARD_MOUNT	"/vol/external01"
+
+static const char *sdcard_dir;
+
+/* Identifies an open file for the SD card model */
+static uint64_t file_id(int fd)
+{
+	struct stat st;
+
+	return fstat(fd, &st) < 0? 0 : st.st_ino;
+}
+
+static int from_errno(void)
+{
+	switch (errno) {
+	case ENOENT:	return FS_STATUS_NOT_FOUND;
+	case EEXIST:	return FS_STATUS_EXISTS;
+	case EISDIR:	return FS_STATUS_NOT_FILE;
+	case ENOSPC:	return FS_STATUS_STORAGE_FULL;
+	case EACCES:
+	case EPERM:	return FS_STATUS_ACCESS_ERROR;
+	default:	return FS_STATUS_FATAL_ERROR;
+	}
+}
+
+/* Turn a Cafe OS path into a host path. Returns -1 if there's none. */
+static int host_path(char *buf, size_t size, const char *path)
+{
+	size_t len = strlen(SDCARD_MOUNT);
+
+	if (strncmp(path, SDCARD_MOUNT, len) != 0 ||
+	    (path[len] != '/' && path[len] != '\0'))
+		return -1;
+
+	snprintf(buf, size, "%s%s", sdcard_dir, path + len);
+	return 0;
+}
+
+static void check_alignment(const void *buffer, const char *what)
+{
+	char msg[64];
+
+	if ((uintptr_t)buffer % FS_IO_BUFFER_ALIGN) {
+		snprintf(msg, sizeof msg, "%s: buffer %p isn't aligned", what,
+				buffer);
+		OSFatal(msg);
+	}
+}
+
+static int host_FSInit(void) { return 0; }
+static int host_FSShutdown(void) { return 0; }
+static int host_FSAddClient(void *client, int err) { return 0; }
+static int host_FSDelClient(void *client) { return 0; }
+static void host_FSInitCmdBlock(void *cmd) { }
+
+static int host_FSGetMountSource(void *client, void *cmd, int type,
+		void *source, int err)
+{
+	if (type != FS_SOURCETYPE_EXTERNAL)
+		return FS_STATUS_NOT_FOUND;
+
+	strcpy(source, "external");
+	return 0;
+}
+
+static int host_FSMount(void *client, void *cmd, void *source, char *target,
+		u32 bytes, int err)
+{
+	snprintf(target, bytes, "%s", SDCARD_MOUNT);
+	return 0;
+}
+
+static int host_FSUnmount(void *client, void *cmd, const char *target, int err)
+{
+	return 0;
+}
+
+static void fill_stat(FSStat *fs, const struct stat *st)
+{
+	memset(fs, 0, sizeof(*fs));
+	fs->flag = S_ISDIR(st->st_mode)? FS_STAT_FLAG_IS_DIRECTORY : 0;
+	fs->permission = st->st_mode & 0777;
+	fs->size = st->st_size;
+	fs->alloc_size = st->st_blocks * 512;
+	fs->ctime = st->st_ctim.tv_sec * 1000000ull + st->st_ctim.tv_nsec / 1000;
+	fs->mtime = st->st_mtim.tv_sec * 1000000ull + st->st_mtim.tv_nsec / 1000;
+}
+
+static int host_FSGetStat(void *client, void *cmd, const char *path,
+		FSStat *fs, int err)
+{
+	char buf[FS_MAX_FULLPATH_SIZE];
+	struct stat st;
+
+	sd_command();
+	if (host_path(buf, sizeof buf, path) < 0)
+		return FS_STATUS_NOT_FOUND;
+	if (stat(buf, &st) < 0)
+		return from_errno();
+
+	fill_stat(fs, &st);
+	return 0;
+}
+
+static int host_FSGetStatFile(void *client, void *cmd, int fd, FSStat *fs,
+		int err)
+{
+	struct stat st;
+
+	sd_command();
+	if (fstat(fd, &st) < 0)
+		return from_errno();
+
+	fill_stat(fs, &st);
+	return 0;
+}
+
+/* Like on FAT, renaming doesn't replace existing files */
+static int host_FSRename(void *client, void *cmd, const char *old_path,
+		const char *new_path, int err)
+{
+	char old_buf[FS_MAX_FULLPATH_SIZE], new_buf[FS_MAX_FULLPATH_SIZE];
+
+	sd_command();
+	if (host_path(old_buf, sizeof old_buf, old_path) < 0 ||
+	    host_path(new_buf, sizeof new_buf, new_path) < 0)
+		return FS_STATUS_NOT_FOUND;
+	if (access(new_buf, F_OK) == 0)
+		return FS_STATUS_EXISTS;
+	if (rename(old_buf, new_buf) < 0)
+		return from_errno();
+
+	return 0;
+}
+
+static int host_FSRemove(void *client, void *cmd, const char *path, int err)
+{
+	char buf[FS_MAX_FULLPATH_SIZE];
+
+	sd_command();
+	if (host_path(buf, sizeof buf, path) < 0)
+		return FS_STATUS_NOT_FOUND;
+	if (remove(buf) < 0)
+		return from_errno();
+
+	return 0;
+}
+
+static int host_FSOpenFile(void *client, void *cmd, const char *path,
+		const char *mode, int *fd, int err)
+{
+	char buf[FS_MAX_FULLPATH_SIZE];
+	int flags, res;
+
+	sd_command();
+	if (host_path(buf, sizeof buf, path) < 0)
+		return FS_STATUS_NOT_FOUND;
+
+	if (!strcmp(mode, "r"))
+		flags = O_RDONLY;
+	else if (!strcmp(mode, "r+"))
+		flags = O_RDWR;
+	else if (!strcmp(mode, "w"))
+		flags = O_WRONLY | O_CREAT | O_TRUNC;
+	else if (!strcmp(mode, "w+"))
+		flags = O_RDWR | O_CREAT | O_TRUNC;
+	else if (!strcmp(mode, "a"))
+		flags = O_WRONLY | O_CREAT | O_APPEND;
+	else
+		return FS_STATUS_ACCESS_ERROR;
+
+	res = open(buf, flags, 0644);
+	if (res < 0)
+		return from_errno();
+
+	*fd = res;
+	return 0;
+}
+
+static int host_FSCloseFile(void *client, void *cmd, int fd, int err)
+{
+	sd_command();
+	return close(fd) < 0? from_errno() : 0;
+}
+
+static int host_FSReadFileWithPos(void *client, void *cmd, void *buffer,
+		int size, int count, u32 pos, int fd, int flag, int err)
+{
+	ssize_t res;
+
+	check_alignment(buffer, "FSReadFile");
+	res = pread(fd, buffer, (size_t)size * count, pos);
+	if (res < 0)
+		return from_errno();
+
+	sd_read(file_id(fd), pos, res);
+	return res;
+}
+
+static int host_FSReadFile(void *client, void *cmd, void *buffer, int size,
+		int count, int fd, int flag, int err)
+{
+	off_t pos = lseek(fd, 0, SEEK_CUR);
+	ssize_t res;
+
+	check_alignment(buffer, "FSReadFile");
+	res = read(fd, buffer, (size_t)size * count);
+	if (res < 0)
+		return from_errno();
+
+	sd_read(file_id(fd), pos, res);
+	return res;
+}
+
+static int host_FSWriteFile(void *client, void *cmd, const void *source,
+		int size, int count, int fd, int flag, int err)
+{
+	off_t pos = lseek(fd, 0, SEEK_CUR);
+	ssize_t res;
+
+	check_alignment(source, "FSWriteFile");
+	res = write(fd, source, (size_t)size * count);
+	if (res < 0)
+		return from_errno();
+
+	sd_write(file_id(fd), pos, res);
+	return res;
+}
+
+static int host_FSFlushFile(void *client, void *cmd, int fd, int err)
+{
+	sd_command();
+	return 0;
+}
+
+static int host_FSSetPosFile(void *client, void *cmd, int fd, u32 pos, int err)
+{
+	sd_command();
+	return lseek(fd, pos, SEEK_SET) < 0? from_errno() : 0;
+}
+
+int (*FSInit)(void);
+int (*FSShutdown)(void);
+int (*FSAddClient)(void *pClient, int errHandling);
+int (*FSDelClient)(void *pClient);
+void (*FSInitCmdBlock)(void *pCmd);
+int (*FSGetMountSource)(void *pClient, void *pCmd, int type, void *source,
+		int errHandling);
+int (*FSMount)(void *pClient, void *pCmd, void *source, char *target,
+		u32 bytes, int errHandling);
+int (*FSUnmount)(void *pClient, void *pCmd, const char *target,
+		int errHandling);
+int (*FSGetStat)(void *pClient, void *pCmd, const char *path, FSStat *stats,
+		int errHandling);
+int (*FSRename)(void *pClient, void *pCmd, const char *oldPath,
+		const char *newPath, int error);
+int (*FSRemove)(void *pClient, void *pCmd, const char *path, int error);
+int (*FSOpenFile)(void *pClient, void *pCmd, const char *path,
+		const char *mode, int *fd, int errHandling);
+int (*FSCloseFile)(void *pClient, void *pCmd, int fd, int errHandling);
+int (*FSReadFile)(void *pClient, void *pCmd, void *buffer, int size,
+		int count, int fd, int flag, int errHandling);
+int (*FSReadFileWithPos)(void *pClient, void *pCmd, void *buffer, int size,
+		int count, u32 pos, int fd, int flag, int errHandling);
+int (*FSWriteFile)(void *pClient, void *pCmd, const void *source,
+		int block_size, int block_count, int fd, int flag,
+		int errHandling);
+int (*FSFlushFile)(void *pClient, void *pCmd, int fd, int error);
+int (*FSSetPosFile)(void *pClient, void *pCmd, int fd, u32 pos, int error);
+int (*FSGetStatFile)(void *pClient, void *pCmd, int fd, FSStat *stats,
+		int error);
+
+static void print_stats(void)
+{
+	fprintf(stderr, "fs: %llu commands, %llu reads (%llu bytes), "
+			"%llu writes (%llu bytes), %llu seeks, %llu slow writes, "
+			"%llu ms\n",
+			(unsigned long long)sd_stats.commands,
+			(unsigned long long)sd_stats.reads,
+			(unsigned long long)sd_stats.bytes_read,
+			(unsigned long long)sd_stats.writes,
+			(unsigned long long)sd_stats.bytes_written,
+			(unsigned long long)sd_stats.seeks,
+			(unsigned long long)sd_stats.slow_writes,
+			(unsigned long long)sd_stats.us / 1000);
+}
+
+void InitFSFunctionPointers(void)
+{
+	sdcard_dir = getenv("HOST_SDCARD");
+	if (!sdcard_dir)
+		sdcard_dir = "sdcard";
+	sd_init();
+	if (getenv("HOST_FS_STATS"))
+		atexit(print_stats);
+
+	FSInit = host_FSInit;
+	FSShutdown = host_FSShutdown;
+	FSAddClient = host_FSAddClient;
+	FSDelClient = host_FSDelClient;
+	FSInitCmdBlock = host_FSInitCmdBlock;
+	FSGetMountSource = host_FSGetMountSource;
+	FSMount = host_FSMount;
+	FSUnmount = host_FSUnmount;
+	FSGetStat = host_FSGetStat;
+	FSRename = host_FSRename;
+	FSRemove = host_FSRemove;
+	FSOpenFile = host_FSOpenFile;
+	FSCloseFile = host_FSCloseFile;
+	FSReadFile = host_FSReadFile;
+	FSReadFileWithPos = host_FSReadFileWithPos;
+	FSWriteFile = host_FSWriteFile;
+	FSFlushFile = host_FSFlushFile;
+	FSSetPosFile = host_FSSetPosFile;
+	FSGetStatFile = host_FSGetStatFile;
+}
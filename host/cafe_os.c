@@ -0,0 +1,479 @@
+/*
+ * Wii U Linux Launcher -- Host build: memory, time, and everything else from coreinit
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <os_functions.h>
+#include <common/common.h>
+#include "host.h"
+#include "../bootlog.h"
+
+unsigned int host_os_firmware = 550;
+
+/* OSGetTime counts at a quarter of the bus clock */
+#define TIMER_CLOCK	(248625000 / 4)
+
+static uint64_t start_ns, virtual_ns;
+static int realtime;
+
+int host_parse_number(const char *str, uint64_t *n)
+{
+	char *end;
+
+	*n = strtoull(str, &end, 0);
+	switch (*end) {
+	case 'k': case 'K': *n <<= 10; end++; break;
+	case 'm': case 'M': *n <<= 20; end++; break;
+	case 'g': case 'G': *n <<= 30; end++; break;
+	}
+
+	return (end == str || *end)? -1 : 0;
+}
+
+uint64_t host_env_number(const char *name, uint64_t def)
+{
+	const char *value = getenv(name);
+	uint64_t n;
+
+	if (!value || !*value)
+		return def;
+
+	if (host_parse_number(value, &n) < 0) {
+		fprintf(stderr, "%s: not a number: %s\n", name, value);
+		exit(2);
+	}
+
+	return n;
+}
+
+uint64_t host_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec - start_ns + virtual_ns;
+}
+
+void host_delay(uint64_t us)
+{
+	if (realtime)
+		usleep(us);
+	else
+		virtual_ns += us * 1000;
+}
+
+static s64 host_OSGetTime(void)
+{
+	return host_time_ns() * (TIMER_CLOCK / 1000) / 1000000;
+}
+
+static void host_os_usleep(u32 usecs)
+{
+	host_delay(usecs);
+}
+
+static int host_OSGetCoreId(void)
+{
+	return 1;
+}
+
+static void host_OSFatal(const char *msg)
+{
+	fprintf(stderr, "OSFatal: %s\n", msg);
+	exit(2);
+}
+
+static int host_os_snprintf(char *s, int n, const char *format, ...)
+{
+	va_list ap;
+	int res;
+
+	va_start(ap, format);
+	res = vsnprintf(s, n, format, ap);
+	va_end(ap);
+
+	return res;
+}
+
+/* Effective and physical addresses are the same in MEM2, see host.h */
+static uintptr_t host_OSEffectiveToPhysical(const void *addr)
+{
+	uintptr_t a = (uintptr_t)addr;
+
+	if (a >= HOST_MEM1_BASE && a < HOST_MEM1_BASE + HOST_MEM1_SIZE)
+		return a - HOST_MEM1_BASE;
+
+	return a;
+}
+
+static void host_cache_op(const void *addr, u32 length) { }
+static void host_cache_op_rw(void *addr, u32 length) { }
+
+/*
+ * There's no IOS, and thus no iosuhax, unless HOST_BOOTLOG names a text
+ * file: Then /dev/iosuhax can be opened, and the IOSU kernel's memory reads
+ * as a boot log (see bootlog.h) with that text in MEM0. Everything else
+ * fails.
+ */
+#define HOST_IOSUHAX_FD	0x1234
+
+static uint8_t *mem0_bootlog;
+
+static void put_be32(uint8_t *p, uint32_t value)
+{
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+static void load_bootlog(void)
+{
+	const char *path = getenv("HOST_BOOTLOG");
+	uint8_t *data;
+	size_t len;
+	FILE *f;
+
+	if (!path || !*path)
+		return;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+
+	mem0_bootlog = calloc(1, BOOTLOG_SIZE);
+	data = mem0_bootlog + offsetof(struct bootlog, data);
+	len = fread(data, 1, BOOTLOG_DATA_SIZE, f);
+	fclose(f);
+
+	put_be32(mem0_bootlog + offsetof(struct bootlog, magic), BOOTLOG_MAGIC);
+	put_be32(mem0_bootlog + offsetof(struct bootlog, len), len);
+	put_be32(mem0_bootlog + offsetof(struct bootlog, csum),
+			bootlog_csum(1, data, len));
+}
+
+static int host_IOS_Open(char *path, unsigned int mode)
+{
+	if (mem0_bootlog && !strcmp(path, "/dev/iosuhax"))
+		return HOST_IOSUHAX_FD;
+
+	return -6;
+}
+
+static int host_IOS_Close(int fd)
+{
+	return (fd == HOST_IOSUHAX_FD)? 0 : -1;
+}
+
+/*
+ * Only the kernel backdoor's 32-bit reads and writes, and copies out of the
+ * boot log into MEM2, whose physical addresses are its effective ones here
+ * (see hax.c)
+ */
+static int host_IOS_Ioctl(int fd, unsigned int request, void *input_buffer,
+		unsigned int input_buffer_len, void *output_buffer,
+		unsigned int output_buffer_len)
+{
+	const int *req = input_buffer;
+	int *resp = output_buffer;
+	uint32_t addr, size;
+	uint8_t *p;
+
+	if (fd != HOST_IOSUHAX_FD || request != 2 || input_buffer_len < 20 ||
+	    req[0] != 0x81 || req[1] < 1 || req[1] > 3)
+		return -1;
+
+	if (req[1] == 3) {
+		addr = req[3];
+		size = req[4];
+		if (addr < BOOTLOG_PHYS || size > BOOTLOG_SIZE ||
+		    addr - BOOTLOG_PHYS > BOOTLOG_SIZE - size)
+			return -1;
+		memcpy((void *)(uintptr_t)(uint32_t)req[2],
+				mem0_bootlog + (addr - BOOTLOG_PHYS), size);
+		resp[0] = 0;
+		return 0;
+	}
+
+	addr = req[2];
+	if (addr < BOOTLOG_PHYS || addr - BOOTLOG_PHYS > BOOTLOG_SIZE - 4)
+		return -1;
+	p = mem0_bootlog + (addr - BOOTLOG_PHYS);
+
+	if (req[1] == 2) {
+		put_be32(p, req[3]);
+		return 0;
+	}
+
+	resp[0] = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	return 0;
+}
+
+/*
+ * The MEM2 heap: A first-fit allocator with a 64-byte header in front of
+ * each block. Neighbouring free blocks are merged when a block is freed.
+ */
+struct block {
+	uint32_t size;		/* including the header */
+	uint32_t prev_size;	/* of the block before this one, or 0 */
+	uint32_t used;
+	uint8_t pad[52];
+};
+
+#define HEADER		sizeof(struct block)
+#define MIN_BLOCK	(2 * HEADER)
+
+static uint8_t *heap_start, *heap_end;
+
+static struct block *next_block(struct block *b)
+{
+	uint8_t *next = (uint8_t *)b + b->size;
+
+	return (next < heap_end)? (struct block *)next : NULL;
+}
+
+static struct block *prev_block(struct block *b)
+{
+	return b->prev_size? (struct block *)((uint8_t *)b - b->prev_size) :
+		NULL;
+}
+
+/* Cut a block in two; the second one is free */
+static void split(struct block *b, uint32_t size)
+{
+	struct block *rest, *next;
+
+	if (b->size - size < MIN_BLOCK)
+		return;
+
+	rest = (struct block *)((uint8_t *)b + size);
+	rest->size = b->size - size;
+	rest->prev_size = size;
+	rest->used = 0;
+	b->size = size;
+
+	next = next_block(rest);
+	if (next)
+		next->prev_size = rest->size;
+}
+
+static void merge_with_next(struct block *b)
+{
+	struct block *next = next_block(b), *after;
+
+	if (!next || next->used)
+		return;
+
+	b->size += next->size;
+	after = next_block(b);
+	if (after)
+		after->prev_size = b->size;
+}
+
+/* Where the payload of an allocation in this block would start */
+static uint8_t *fit(struct block *b, uint32_t size, uint32_t align)
+{
+	uint8_t *start = (uint8_t *)b + HEADER, *p;
+
+	p = (uint8_t *)(((uintptr_t)start + align - 1) & ~(uintptr_t)(align - 1));
+	while (p != start && p - start < MIN_BLOCK)
+		p += align;
+
+	if (p + size > (uint8_t *)b + b->size)
+		return NULL;
+
+	return p;
+}
+
+static void *heap_alloc(int heap, unsigned int size, int align)
+{
+	struct block *b, *nb;
+	uint8_t *p;
+
+	if (align < (int)HEADER)
+		align = HEADER;
+	size = (size + HEADER - 1) & ~(HEADER - 1);
+	if (size == 0)
+		size = HEADER;
+
+	for (b = (struct block *)heap_start; b; b = next_block(b)) {
+		if (b->used || !(p = fit(b, size, align)))
+			continue;
+
+		/* Leave the space before the payload as a free block */
+		nb = (struct block *)(p - HEADER);
+		if (nb != b) {
+			split(b, (uint8_t *)nb - (uint8_t *)b);
+			b = nb;
+		}
+
+		split(b, HEADER + size);
+		b->used = 1;
+		return p;
+	}
+
+	return NULL;
+}
+
+static void heap_free(int heap, void *ptr)
+{
+	struct block *b, *prev;
+
+	if (!ptr)
+		return;
+
+	b = (struct block *)((uint8_t *)ptr - HEADER);
+	if ((uint8_t *)b < heap_start || (uint8_t *)b >= heap_end || !b->used)
+		host_OSFatal("MEMFreeToExpHeap: not an allocated block");
+
+	b->used = 0;
+	merge_with_next(b);
+	prev = prev_block(b);
+	if (prev && !prev->used)
+		merge_with_next(prev);
+}
+
+static unsigned int heap_allocatable(int heap, int align)
+{
+	struct block *b;
+	uint32_t best = 0, avail;
+	uint8_t *p;
+
+	if (align < (int)HEADER)
+		align = HEADER;
+
+	for (b = (struct block *)heap_start; b; b = next_block(b)) {
+		if (b->used || !(p = fit(b, 0, align)))
+			continue;
+		avail = (uint8_t *)b + b->size - p;
+		if (avail > best)
+			best = avail;
+	}
+
+	return best;
+}
+
+static void *host_MEMAllocFromDefaultHeapEx(int size, int align)
+{
+	return heap_alloc(MEM_BASE_HEAP_MEM2, size, align);
+}
+
+static void *host_MEMAllocFromDefaultHeap(int size)
+{
+	return heap_alloc(MEM_BASE_HEAP_MEM2, size, 0x40);
+}
+
+static void host_MEMFreeToDefaultHeap(void *ptr)
+{
+	heap_free(MEM_BASE_HEAP_MEM2, ptr);
+}
+
+static int host_MEMGetBaseHeapHandle(int arena)
+{
+	return arena;
+}
+
+static void *map_fixed(uintptr_t addr, size_t size, const char *what)
+{
+	void *p = mmap((void *)addr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+			MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (p != (void *)addr) {
+		fprintf(stderr, "Can't map %s at %#lx\n", what,
+				(unsigned long)addr);
+		exit(2);
+	}
+
+	return p;
+}
+
+static uintptr_t default_heap_functions[3];
+
+uintptr_t *pMEMAllocFromDefaultHeapEx = &default_heap_functions[0];
+uintptr_t *pMEMAllocFromDefaultHeap = &default_heap_functions[1];
+uintptr_t *pMEMFreeToDefaultHeap = &default_heap_functions[2];
+
+void (*OSFatal)(const char *msg);
+int (*__os_snprintf)(char *s, int n, const char *format, ...);
+uintptr_t (*OSEffectiveToPhysical)(const void *addr);
+void (*DCFlushRange)(const void *addr, u32 length);
+void (*DCInvalidateRange)(void *addr, u32 length);
+void (*DCStoreRange)(const void *addr, u32 length);
+void (*os_usleep)(u32 usecs);
+s64 (*OSGetTime)(void);
+int (*OSGetCoreId)(void);
+int (*IOS_Open)(char *path, unsigned int mode);
+int (*IOS_Close)(int fd);
+int (*IOS_Ioctl)(int fd, unsigned int request, void *input_buffer,
+		unsigned int input_buffer_len, void *output_buffer,
+		unsigned int output_buffer_len);
+int (*MEMGetBaseHeapHandle)(int mem_arena);
+unsigned int (*MEMGetAllocatableSizeForExpHeapEx)(int heap, int align);
+void *(*MEMAllocFromExpHeapEx)(int heap, unsigned int size, int align);
+void (*MEMFreeToExpHeap)(int heap, void *ptr);
+
+void InitOSFunctionPointers(void)
+{
+	size_t mem2_size = host_env_number("HOST_MEM2", HOST_MEM2_SIZE);
+	struct block *b;
+
+	realtime = getenv("HOST_REALTIME") != NULL;
+	start_ns = host_time_ns();
+	load_bootlog();
+
+	map_fixed(HOST_MEM1_BASE, HOST_MEM1_SIZE, "MEM1");
+	heap_start = map_fixed(HOST_MEM2_BASE, mem2_size, "MEM2");
+	heap_end = heap_start + (mem2_size & ~(HEADER - 1));
+	b = (struct block *)heap_start;
+	b->size = heap_end - heap_start;
+	b->prev_size = 0;
+	b->used = 0;
+
+	default_heap_functions[0] = (uintptr_t)host_MEMAllocFromDefaultHeapEx;
+	default_heap_functions[1] = (uintptr_t)host_MEMAllocFromDefaultHeap;
+	default_heap_functions[2] = (uintptr_t)host_MEMFreeToDefaultHeap;
+
+	OSFatal = host_OSFatal;
+	__os_snprintf = host_os_snprintf;
+	OSEffectiveToPhysical = host_OSEffectiveToPhysical;
+	DCFlushRange = host_cache_op;
+	DCInvalidateRange = host_cache_op_rw;
+	DCStoreRange = host_cache_op;
+	os_usleep = host_os_usleep;
+	OSGetTime = host_OSGetTime;
+	OSGetCoreId = host_OSGetCoreId;
+	IOS_Open = host_IOS_Open;
+	IOS_Close = host_IOS_Close;
+	IOS_Ioctl = host_IOS_Ioctl;
+	MEMGetBaseHeapHandle = host_MEMGetBaseHeapHandle;
+	MEMGetAllocatableSizeForExpHeapEx = heap_allocatable;
+	MEMAllocFromExpHeapEx = heap_alloc;
+	MEMFreeToExpHeap = heap_free;
+
+	host_screen_init();
+}
@@ -0,0 +1,353 @@
+/*
+ * Wii U Linux Launcher -- Host build: OSScreen, drawing into memory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Each screen's buffer holds two frames, like on the console: drawing goes
+ * to the back one, and OSScreenFlipBuffersEx swaps them. Pixels are stored
+ * as big-endian RGBX words in the buffer that the launcher set up. Text is
+ * drawn with the ARM payload's 8x8 font, stretched to 8x16, in cells of
+ * 12x24 pixels, and additionally kept as characters, so that it can be
+ * inspected.
+ *
+ * What happens to the frames is controlled by environment variables:
+ *
+ *	HOST_SCREEN_LOG		append the TV's text to this file whenever a
+ *				frame with different text is shown
+ *	HOST_SCREENSHOTS	save every frame that differs from the one
+ *				saved before as a PNG file in this directory,
+ *				named tv-<n>.png or drc-<n>.png, where n
+ *				counts the flips of that screen
+ *	HOST_SCREEN_STATS	print how many pixels each frame took to draw
+ *				on exit, and how long that took on the host
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <os_functions.h>
+#include "../arm/font.h"
+#include "host.h"
+
+#define TEXT_COLS	104
+#define TEXT_ROWS	30
+
+#define CELL_WIDTH	12
+#define CELL_HEIGHT	24
+#define GLYPH_X		2	/* where the glyph is in its cell */
+#define GLYPH_Y		4
+
+struct frame_stats {
+	uint64_t frames;
+	uint64_t pixels, max_pixels;
+	uint64_t calls;
+	uint64_t ns;
+};
+
+struct screen {
+	const char *name;
+	unsigned int width, height, pitch;
+	unsigned int cols, rows;
+
+	uint32_t *buffer;
+	int enabled;
+	int back;		/* which of the two frames is drawn into */
+
+	char text[2][TEXT_ROWS][TEXT_COLS + 1];
+
+	/* What the back frame took to draw so far */
+	uint64_t pixels, calls, ns;
+	struct frame_stats stats;
+
+	unsigned int flips;
+	uint64_t saved_hash;	/* of the last screenshot */
+};
+
+static struct screen screens[2] = {
+	{ .name = "tv", .width = 1280, .height = 720, .pitch = 1280,
+	  .cols = 104, .rows = 30 },
+	{ .name = "drc", .width = 854, .height = 480, .pitch = 896,
+	  .cols = 70, .rows = 18 },
+};
+
+static FILE *screen_log;
+static char logged_text[TEXT_ROWS][TEXT_COLS + 1];
+static const char *screenshot_dir;
+
+static struct screen *get_screen(unsigned int num)
+{
+	if (num > 1)
+		OSFatal("OSScreen: bad buffer number");
+	return &screens[num];
+}
+
+static size_t frame_words(const struct screen *s)
+{
+	return (size_t)s->pitch * s->height;
+}
+
+static uint32_t *back_frame(struct screen *s)
+{
+	return s->buffer + s->back * frame_words(s);
+}
+
+/* OSScreen's pixels are big-endian */
+static uint32_t to_be32(uint32_t x)
+{
+	return __builtin_bswap32(x);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Account for one call, which wrote some pixels */
+static void account(struct screen *s, uint64_t start, uint64_t pixels)
+{
+	s->calls++;
+	s->pixels += pixels;
+	s->ns += now_ns() - start;
+}
+
+static void host_OSScreenInit(void) { }
+
+static unsigned int host_OSScreenGetBufferSizeEx(unsigned int num)
+{
+	return frame_words(get_screen(num)) * 4 * 2;
+}
+
+static int host_OSScreenSetBufferEx(unsigned int num, void *addr)
+{
+	get_screen(num)->buffer = addr;
+	return 0;
+}
+
+static int host_OSScreenEnableEx(unsigned int num, int enable)
+{
+	get_screen(num)->enabled = enable;
+	return 0;
+}
+
+static int host_OSScreenClearBufferEx(unsigned int num, unsigned int color)
+{
+	struct screen *s = get_screen(num);
+	uint32_t *p = back_frame(s), c = to_be32(color);
+	uint64_t start = now_ns();
+	size_t i;
+
+	for (i = 0; i < frame_words(s); i++)
+		p[i] = c;
+
+	memset(s->text[s->back], 0, sizeof(s->text[0]));
+	account(s, start, frame_words(s));
+	return 0;
+}
+
+static int host_OSScreenPutPixelEx(unsigned int num, unsigned int x,
+		unsigned int y, u32 color)
+{
+	struct screen *s = get_screen(num);
+	uint64_t start = now_ns();
+
+	if (x < s->width && y < s->height)
+		back_frame(s)[y * s->pitch + x] = to_be32(color);
+	account(s, start, 1);
+	return 0;
+}
+
+/* Draw a white glyph; the background stays. Returns the pixels written. */
+static unsigned int put_glyph(struct screen *s, unsigned int col,
+		unsigned int row, unsigned char ch)
+{
+	const unsigned char *glyph;
+	uint32_t *p, white = 0xffffffff;
+	unsigned int x, y, n = 0;
+
+	if (ch < FONT_OFFSET || ch >= FONT_END)
+		return 0;
+	glyph = &font[(ch - FONT_OFFSET) * 8];
+
+	p = back_frame(s) + (row * CELL_HEIGHT + GLYPH_Y) * s->pitch +
+		col * CELL_WIDTH + GLYPH_X;
+	for (y = 0; y < 16; y++, p += s->pitch) {
+		for (x = 0; x < 8; x++) {
+			if (glyph[y / 2] & (0x80 >> x)) {
+				p[x] = white;
+				n++;
+			}
+		}
+	}
+
+	return n;
+}
+
+/* Text that doesn't fit is cut off */
+static int host_OSScreenPutFontEx(unsigned int num, unsigned int x,
+		unsigned int y, const char *str)
+{
+	struct screen *s = get_screen(num);
+	uint64_t start = now_ns(), pixels = 0;
+	char *line;
+
+	if (y < s->rows) {
+		line = s->text[s->back][y];
+		for (; *str && x < s->cols; str++, x++) {
+			line[x] = *str;
+			if ((x + 1) * CELL_WIDTH <= s->width &&
+			    (y + 1) * CELL_HEIGHT <= s->height)
+				pixels += put_glyph(s, x, y, *str);
+		}
+	}
+
+	account(s, start, pixels);
+	return 0;
+}
+
+static void log_text(const struct screen *s, int frame)
+{
+	unsigned int x, y;
+
+	if (!memcmp(logged_text, s->text[frame], sizeof(logged_text)))
+		return;
+	memcpy(logged_text, s->text[frame], sizeof(logged_text));
+
+	fprintf(screen_log, "--- %llu ms\n",
+			(unsigned long long)(host_time_ns() / 1000000));
+	for (y = 0; y < s->rows; y++) {
+		char line[TEXT_COLS + 1];
+
+		for (x = 0; x < s->cols; x++)
+			line[x] = s->text[frame][y][x]? s->text[frame][y][x] : ' ';
+		while (x > 0 && line[x - 1] == ' ')
+			x--;
+		line[x] = '\0';
+		fprintf(screen_log, "%s\n", line);
+	}
+	fflush(screen_log);
+}
+
+/* FNV-1a, to tell whether a frame changed */
+static uint64_t hash_frame(const struct screen *s, const uint32_t *p)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	size_t i;
+
+	for (i = 0; i < frame_words(s); i++)
+		h = (h ^ p[i]) * 0x100000001b3ull;
+	return h;
+}
+
+static void save_screenshot(struct screen *s, const uint32_t *p)
+{
+	char filename[4096];
+	uint64_t hash = hash_frame(s, p);
+
+	if (hash == s->saved_hash)
+		return;
+	s->saved_hash = hash;
+
+	snprintf(filename, sizeof filename, "%s/%s-%05u.png", screenshot_dir,
+			s->name, s->flips);
+	if (png_write(filename, p, s->width, s->height, s->pitch) < 0)
+		perror(filename);
+}
+
+static int host_OSScreenFlipBuffersEx(unsigned int num)
+{
+	struct screen *s = get_screen(num);
+	struct frame_stats *st = &s->stats;
+
+	st->frames++;
+	st->pixels += s->pixels;
+	if (s->pixels > st->max_pixels)
+		st->max_pixels = s->pixels;
+	st->calls += s->calls;
+	st->ns += s->ns;
+	s->pixels = s->calls = s->ns = 0;
+
+	if (s->enabled) {
+		if (screen_log && num == 0)
+			log_text(s, s->back);
+		if (screenshot_dir)
+			save_screenshot(s, back_frame(s));
+	}
+
+	s->flips++;
+	s->back ^= 1;
+	return 0;
+}
+
+static void print_stats(void)
+{
+	const struct frame_stats *st;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		st = &screens[i].stats;
+		if (!st->frames)
+			continue;
+
+		fprintf(stderr, "screen %s: %llu frames, %llu pixels per frame "
+				"(max %llu), %.1f calls per frame, %.1f us per "
+				"frame\n", screens[i].name,
+				(unsigned long long)st->frames,
+				(unsigned long long)(st->pixels / st->frames),
+				(unsigned long long)st->max_pixels,
+				(double)st->calls / st->frames,
+				st->ns / 1000.0 / st->frames);
+	}
+}
+
+void (*OSScreenInit)(void);
+unsigned int (*OSScreenGetBufferSizeEx)(unsigned int bufferNum);
+int (*OSScreenSetBufferEx)(unsigned int bufferNum, void *addr);
+int (*OSScreenClearBufferEx)(unsigned int bufferNum, unsigned int color);
+int (*OSScreenFlipBuffersEx)(unsigned int bufferNum);
+int (*OSScreenPutFontEx)(unsigned int bufferNum, unsigned int posX,
+		unsigned int posY, const char *buffer);
+int (*OSScreenPutPixelEx)(unsigned int bufferNum, unsigned int posX,
+		unsigned int posY, u32 color);
+int (*OSScreenEnableEx)(unsigned int bufferNum, int enable);
+
+void host_screen_init(void)
+{
+	const char *log = getenv("HOST_SCREEN_LOG");
+
+	if (log) {
+		screen_log = fopen(log, "a");
+		if (!screen_log)
+			perror(log);
+	}
+
+	screenshot_dir = getenv("HOST_SCREENSHOTS");
+	if (getenv("HOST_SCREEN_STATS"))
+		atexit(print_stats);
+
+	OSScreenInit = host_OSScreenInit;
+	OSScreenGetBufferSizeEx = host_OSScreenGetBufferSizeEx;
+	OSScreenSetBufferEx = host_OSScreenSetBufferEx;
+	OSScreenClearBufferEx = host_OSScreenClearBufferEx;
+	OSScreenFlipBuffersEx = host_OSScreenFlipBuffersEx;
+	OSScreenPutFontEx = host_OSScreenPutFontEx;
+	OSScreenPutPixelEx = host_OSScreenPutPixelEx;
+	OSScreenEnableEx = host_OSScreenEnableEx;
+}
@@ -0,0 +1,156 @@
+/*
+ * Wii U Linux Launcher -- Host build: the gamepad, driven by a script
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The file named by HOST_VPAD_SCRIPT says which buttons are held, one line
+ * per step:
+ *
+ *	# Wait a second, then press A for one frame
+ *	50
+ *	1 A
+ *	10 DOWN
+ *	none 20
+ *
+ * "<frames> [BUTTON...]" holds the buttons for that many calls to VPADRead;
+ * "none <frames>" makes the gamepad go away. When the script ends (or if
+ * there is none), HOME is held, which makes the launcher exit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <os_functions.h>
+#include <vpad_functions.h>
+#include "host.h"
+
+static const struct {
+	const char *name;
+	u32 mask;
+} buttons[] = {
+	{ "A", VPAD_BUTTON_A },		{ "B", VPAD_BUTTON_B },
+	{ "X", VPAD_BUTTON_X },		{ "Y", VPAD_BUTTON_Y },
+	{ "LEFT", VPAD_BUTTON_LEFT },	{ "RIGHT", VPAD_BUTTON_RIGHT },
+	{ "UP", VPAD_BUTTON_UP },	{ "DOWN", VPAD_BUTTON_DOWN },
+	{ "ZL", VPAD_BUTTON_ZL },	{ "ZR", VPAD_BUTTON_ZR },
+	{ "L", VPAD_BUTTON_L },		{ "R", VPAD_BUTTON_R },
+	{ "PLUS", VPAD_BUTTON_PLUS },	{ "MINUS", VPAD_BUTTON_MINUS },
+	{ "HOME", VPAD_BUTTON_HOME },	{ "SYNC", VPAD_BUTTON_SYNC },
+};
+#define NR_BUTTONS	(sizeof(buttons) / sizeof(buttons[0]))
+
+static FILE *script;
+static const char *script_name;
+static int script_line;
+
+/* The current step */
+static unsigned long frames_left;
+static u32 held, last_held;
+static int absent;
+
+static void script_error(const char *what)
+{
+	fprintf(stderr, "%s:%d: %s\n", script_name, script_line, what);
+	exit(2);
+}
+
+static u32 parse_button(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < NR_BUTTONS; i++)
+		if (!strcmp(buttons[i].name, name))
+			return buttons[i].mask;
+
+	script_error("unknown button");
+	return 0;
+}
+
+/* Read the next step. Returns -1 at the end of the script. */
+static int next_step(void)
+{
+	char line[256], *word, *end;
+
+	while (script && fgets(line, sizeof line, script)) {
+		script_line++;
+		if ((end = strchr(line, '#')))
+			*end = '\0';
+
+		word = strtok(line, " \t\r\n");
+		if (!word)
+			continue;
+
+		absent = !strcmp(word, "none");
+		if (absent)
+			word = strtok(NULL, " \t\r\n");
+		if (!word)
+			script_error("missing frame count");
+
+		frames_left = strtoul(word, &end, 10);
+		if (*end || frames_left == 0)
+			script_error("bad frame count");
+
+		held = 0;
+		while ((word = strtok(NULL, " \t\r\n")))
+			held |= parse_button(word);
+		return 0;
+	}
+
+	return -1;
+}
+
+static int host_VPADRead(int chan, VPADData *buffer, u32 buffer_size,
+		s32 *error)
+{
+	if (frames_left == 0 && next_step() < 0) {
+		absent = 0;
+		held = VPAD_BUTTON_HOME;
+		frames_left = 1;
+	}
+	frames_left--;
+
+	memset(buffer, 0, sizeof(*buffer));
+	if (absent) {
+		*error = VPAD_READ_NO_SAMPLES;
+		return 0;
+	}
+
+	buffer->btns_h = held;
+	buffer->btns_d = held & ~last_held;
+	buffer->btns_r = last_held & ~held;
+	buffer->tpdata.invalid = 1;
+	last_held = held;
+
+	*error = 0;
+	return 1;
+}
+
+int (*VPADRead)(int chan, VPADData *buffer, u32 buffer_size, s32 *error);
+
+void InitVPadFunctionPointers(void)
+{
+	script_name = getenv("HOST_VPAD_SCRIPT");
+	if (script_name) {
+		script = fopen(script_name, "r");
+		if (!script) {
+			perror(script_name);
+			exit(2);
+		}
+	}
+
+	VPADRead = host_VPADRead;
+}
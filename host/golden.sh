@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Wii U Linux Launcher -- Compare the screens to known good ones
+#
+# Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 2.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program, in the file LICENSE.GPLv2.
+
+# Usage: host/golden.sh [-u] [golden/<scenario>.vpad...]
+#
+# Runs the launcher with each gamepad script in golden/, against the SD card
+# in golden/sd, and compares the checksums of the screenshots with the ones
+# in golden/<scenario>.sums. The screenshots of a scenario that doesn't
+# match are kept in golden-out/<scenario>/. With -u, the checksums are
+# updated instead; look at the screenshots before committing them. If there
+# is a golden/<scenario>.log, it is the boot log that the last boot left.
+#
+# The launcher is built with a fixed version string for this, because the
+# version is on every screen.
+
+set -e
+cd "$(dirname "$0")"
+
+update=0
+if [ "$1" = "-u" ]; then
+	update=1
+	shift
+fi
+if [ $# -eq 0 ]; then
+	set -- golden/*.vpad
+fi
+
+VERSION=golden make -s linux-host
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+status=0
+
+for script in "$@"; do
+	name=$(basename "$script" .vpad)
+	out=golden-out/$name
+
+	rm -rf "$tmp/sd" "$out"
+	cp -r golden/sd "$tmp/sd"
+	mkdir -p "$out"
+
+	bootlog=
+	if [ -f "golden/$name.log" ]; then
+		bootlog="golden/$name.log"
+	fi
+
+	HOST_SDCARD="$tmp/sd" HOST_VPAD_SCRIPT="$script" \
+		HOST_SCREENSHOTS="$out" HOST_BOOTLOG="$bootlog" ./linux-host
+	(cd "$out" && sha1sum *.png) > "$tmp/$name.sums"
+
+	if [ $update = 1 ]; then
+		cp "$tmp/$name.sums" "golden/$name.sums"
+		echo "$name: updated, see $out"
+	elif cmp -s "$tmp/$name.sums" "golden/$name.sums"; then
+		rm -rf "$out"
+		echo "$name: ok"
+	else
+		diff -u "golden/$name.sums" "$tmp/$name.sums" || true
+		echo "$name: FAILED, see $out"
+		status=1
+	fi
+done
+
+rmdir golden-out 2>/dev/null || true
+exit $status
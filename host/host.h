@@ -0,0 +1,70 @@
+/*
+ * Wii U Linux Launcher -- Host build: things the stand-ins share
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _HOST_H
+#define _HOST_H
+
+#include <stdint.h>
+
+/*
+ * Cafe OS' view of memory is recreated at the same addresses, so that the
+ * launcher's pointers and physical addresses work unchanged: MEM1 is mapped
+ * at its usual effective address, and the default heap lives in a MEM2
+ * mapping whose effective and physical addresses are the same.
+ */
+#define HOST_MEM1_BASE		0xf4000000
+#define HOST_MEM1_SIZE		0x02000000
+#define HOST_MEM2_BASE		0x10000000
+#define HOST_MEM2_SIZE		0x20000000	/* default, see HOST_MEM2 */
+
+/*
+ * Time passes in two ways: normally, and when something is simulated to take
+ * a while (sleeping, slow I/O). The latter only advances a virtual clock,
+ * unless HOST_REALTIME is set, so that tests run as fast as possible, while
+ * OSGetTime still reports the time a console would have needed.
+ */
+extern void host_delay(uint64_t us);
+extern uint64_t host_time_ns(void);
+
+/* A number, with an optional K, M or G suffix. Returns -1 if it isn't one. */
+extern int host_parse_number(const char *str, uint64_t *n);
+
+/* An environment variable as a number */
+extern uint64_t host_env_number(const char *name, uint64_t def);
+
+/* How long SD card accesses take (see sdcard.c). file identifies the file. */
+struct sd_stats {
+	uint64_t commands, reads, writes, seeks, slow_writes;
+	uint64_t bytes_read, bytes_written;
+	uint64_t us;		/* spent in total */
+};
+
+extern struct sd_stats sd_stats;
+
+extern void sd_init(void);
+extern void sd_command(void);
+extern void sd_read(uint64_t file, uint64_t pos, uint64_t len);
+extern void sd_write(uint64_t file, uint64_t pos, uint64_t len);
+
+extern void host_screen_init(void);
+
+/* See png.c */
+extern int png_write(const char *filename, const uint32_t *pixels,
+		unsigned int width, unsigned int height, unsigned int pitch);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Wii U Linux Launcher -- Host build: stand-in for common/common.h
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef COMMON_H
+#define	COMMON_H
+
+/* There's no OS at 0x00800000 to ask */
+extern unsigned int host_os_firmware;
+#define OS_FIRMWARE	host_os_firmware
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Wii U Linux Launcher -- Host build: stand-in for dynamic_libs' fs_defs.h
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef FS_DEFS_H
+#define FS_DEFS_H
+
+#include <gctypes.h>
+
+#define FS_MAX_LOCALPATH_SIZE		511
+#define FS_MAX_MOUNTPATH_SIZE		128
+#define FS_MAX_FULLPATH_SIZE		(FS_MAX_LOCALPATH_SIZE + FS_MAX_MOUNTPATH_SIZE)
+#define FS_MOUNT_SOURCE_SIZE		0x300
+#define FS_SOURCETYPE_EXTERNAL		0
+#define FS_SOURCETYPE_HFIO		1
+
+#define FS_IO_BUFFER_ALIGN		64
+
+#define FS_STATUS_OK			0
+#define FS_STATUS_EXISTS		-5
+#define FS_STATUS_NOT_FOUND		-6
+#define FS_STATUS_NOT_FILE		-7
+#define FS_STATUS_ACCESS_ERROR		-9
+#define FS_STATUS_STORAGE_FULL		-12
+#define FS_STATUS_FATAL_ERROR		-0x400
+
+#define FS_STAT_FLAG_IS_DIRECTORY	0x80000000
+
+typedef struct { u8 buffer[0x1700]; } FSClient;
+typedef struct { u8 buffer[0xa80]; } FSCmdBlock;
+
+typedef struct {
+	u32 flag;
+	u32 permission;
+	u32 owner_id;
+	u32 group_id;
+	u32 size;
+	u32 alloc_size;
+	u64 quota_size;
+	u32 ent_id;
+	u64 ctime;
+	u64 mtime;
+	u8 attributes[48];
+} __attribute__((packed)) FSStat;
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Wii U Linux Launcher -- Host build: stand-in for dynamic_libs' fs_functions.h
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef FS_FUNCTIONS_H
+#define FS_FUNCTIONS_H
+
+#include <gctypes.h>
+#include "fs_defs.h"
+
+extern void InitFSFunctionPointers(void);
+
+extern int (*FSInit)(void);
+extern int (*FSShutdown)(void);
+extern int (*FSAddClient)(void *pClient, int errHandling);
+extern int (*FSDelClient)(void *pClient);
+extern void (*FSInitCmdBlock)(void *pCmd);
+extern int (*FSGetMountSource)(void *pClient, void *pCmd, int type,
+		void *source, int errHandling);
+extern int (*FSMount)(void *pClient, void *pCmd, void *source, char *target,
+		u32 bytes, int errHandling);
+extern int (*FSUnmount)(void *pClient, void *pCmd, const char *target,
+		int errHandling);
+
+extern int (*FSGetStat)(void *pClient, void *pCmd, const char *path,
+		FSStat *stats, int errHandling);
+extern int (*FSRename)(void *pClient, void *pCmd, const char *oldPath,
+		const char *newPath, int error);
+extern int (*FSRemove)(void *pClient, void *pCmd, const char *path,
+		int error);
+
+extern int (*FSOpenFile)(void *pClient, void *pCmd, const char *path,
+		const char *mode, int *fd, int errHandling);
+extern int (*FSCloseFile)(void *pClient, void *pCmd, int fd, int errHandling);
+extern int (*FSReadFile)(void *pClient, void *pCmd, void *buffer, int size,
+		int count, int fd, int flag, int errHandling);
+extern int (*FSReadFileWithPos)(void *pClient, void *pCmd, void *buffer,
+		int size, int count, u32 pos, int fd, int flag,
+		int errHandling);
+extern int (*FSWriteFile)(void *pClient, void *pCmd, const void *source,
+		int block_size, int block_count, int fd, int flag,
+		int errHandling);
+extern int (*FSFlushFile)(void *pClient, void *pCmd, int fd, int error);
+extern int (*FSSetPosFile)(void *pClient, void *pCmd, int fd, u32 pos,
+		int error);
+extern int (*FSGetStatFile)(void *pClient, void *pCmd, int fd,
+		FSStat *stats, int error);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Wii U Linux Launcher -- Host build: stand-in for dynamic_libs' os_functions.h
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Only what the launcher uses is declared here, with the same names and
+ * (as far as it matters) the same types as in dynamic_libs. The functions
+ * are implemented in host/cafe_*.c.
+ */
+
+#ifndef OS_FUNCTIONS_H
+#define OS_FUNCTIONS_H
+
+#include <stdint.h>
+#include <gctypes.h>
+
+extern void InitOSFunctionPointers(void);
+
+/* dynamic_libs keeps these as pointers to the function pointers */
+extern uintptr_t *pMEMAllocFromDefaultHeapEx;
+extern uintptr_t *pMEMAllocFromDefaultHeap;
+extern uintptr_t *pMEMFreeToDefaultHeap;
+
+extern void (*OSFatal)(const char *msg);
+extern int (*__os_snprintf)(char *s, int n, const char *format, ...);
+extern uintptr_t (*OSEffectiveToPhysical)(const void *addr);
+extern void (*DCFlushRange)(const void *addr, u32 length);
+extern void (*DCInvalidateRange)(void *addr, u32 length);
+extern void (*DCStoreRange)(const void *addr, u32 length);
+extern void (*os_usleep)(u32 usecs);
+extern s64 (*OSGetTime)(void);
+extern int (*OSGetCoreId)(void);
+
+extern int (*IOS_Open)(char *path, unsigned int mode);
+extern int (*IOS_Close)(int fd);
+extern int (*IOS_Ioctl)(int fd, unsigned int request, void *input_buffer,
+		unsigned int input_buffer_len, void *output_buffer,
+		unsigned int output_buffer_len);
+
+extern void (*OSScreenInit)(void);
+extern unsigned int (*OSScreenGetBufferSizeEx)(unsigned int bufferNum);
+extern int (*OSScreenSetBufferEx)(unsigned int bufferNum, void *addr);
+extern int (*OSScreenClearBufferEx)(unsigned int bufferNum, unsigned int color);
+extern int (*OSScreenFlipBuffersEx)(unsigned int bufferNum);
+extern int (*OSScreenPutFontEx)(unsigned int bufferNum, unsigned int posX,
+		unsigned int posY, const char *buffer);
+extern int (*OSScreenPutPixelEx)(unsigned int bufferNum, unsigned int posX,
+		unsigned int posY, u32 color);
+extern int (*OSScreenEnableEx)(unsigned int bufferNum, int enable);
+
+#define MEM_BASE_HEAP_MEM1	0
+#define MEM_BASE_HEAP_MEM2	1
+
+extern int (*MEMGetBaseHeapHandle)(int mem_arena);
+extern unsigned int (*MEMGetAllocatableSizeForExpHeapEx)(int heap, int align);
+extern void *(*MEMAllocFromExpHeapEx)(int heap, unsigned int size, int align);
+extern void (*MEMFreeToExpHeap)(int heap, void *ptr);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Wii U Linux Launcher -- Host build: stand-in for dynamic_libs' vpad_functions.h
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef VPAD_FUNCTIONS_H
+#define VPAD_FUNCTIONS_H
+
+#include <gctypes.h>
+
+#define VPAD_BUTTON_A		0x8000
+#define VPAD_BUTTON_B		0x4000
+#define VPAD_BUTTON_X		0x2000
+#define VPAD_BUTTON_Y		0x1000
+#define VPAD_BUTTON_LEFT	0x0800
+#define VPAD_BUTTON_RIGHT	0x0400
+#define VPAD_BUTTON_UP		0x0200
+#define VPAD_BUTTON_DOWN	0x0100
+#define VPAD_BUTTON_ZL		0x0080
+#define VPAD_BUTTON_ZR		0x0040
+#define VPAD_BUTTON_L		0x0020
+#define VPAD_BUTTON_R		0x0010
+#define VPAD_BUTTON_PLUS	0x0008
+#define VPAD_BUTTON_MINUS	0x0004
+#define VPAD_BUTTON_HOME	0x0002
+#define VPAD_BUTTON_SYNC	0x0001
+
+/* What VPADRead reports when there's no gamepad */
+#define VPAD_READ_NO_SAMPLES	-1
+
+typedef struct {
+	u16 x, y;
+	u16 touched;
+	u16 invalid;
+} VPADTPData;
+
+typedef struct {
+	u32 btns_h;
+	u32 btns_d;
+	u32 btns_r;
+	VPADTPData tpdata;
+} VPADData;
+
+extern void InitVPadFunctionPointers(void);
+extern int (*VPADRead)(int chan, VPADData *buffer, u32 buffer_size,
+		s32 *error);
+
+#endif
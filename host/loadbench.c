@@ -0,0 +1,190 @@
+/*
+ * Wii U Linux Launcher -- Measure how long loading takes
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Usage: loadbench [-n runs] [-c cmdline] kernel [dtb [initrd,...]]
+ *
+ * Loads a kernel, dtb and initrd like the launcher would, from the simulated
+ * SD card (see sdcard.c; HOST_SDCARD and HOST_SD_PROFILE apply), and reports
+ * the throughput and the time until the launcher could boot. Relative paths
+ * are relative to the SD card. The times are what the SD card model says,
+ * plus the time the build host actually needed for the rest.
+ *
+ * Every run is a fresh load from the SD card; after them, the copy that the
+ * resident cache kept in MEM2 is loaded once more.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <os_functions.h>
+#include <fs_functions.h>
+#include <vpad_functions.h>
+#include "host.h"
+#include "../fs.h"
+#include "../load.h"
+#include "../main.h"
+#include "../settings.h"
+
+char warning[1024];
+uint32_t *framebuffers[2];
+
+void *xmalloc(size_t size, size_t alignment)
+{
+	void *(* MEMAllocFromDefaultHeapEx)(int size, int alignment) =
+		(void *) *pMEMAllocFromDefaultHeapEx;
+	void *ptr = MEMAllocFromDefaultHeapEx(size, alignment);
+
+	if (!ptr)
+		OSFatal("MEMAllocFromDefaultHeapEx failed");
+
+	return ptr;
+}
+
+void xfree(void *ptr)
+{
+	void (* MEMFreeToDefaultHeap)(void *addr) = (void *) *pMEMFreeToDefaultHeap;
+
+	if (ptr)
+		MEMFreeToDefaultHeap(ptr);
+}
+
+/* Progress messages aren't interesting here */
+void draw_gui(void)
+{
+}
+
+/* Make a path on the command line a path on the SD card. A list of paths is
+ * separated by commas. */
+static void sd_path(char *buf, size_t size, const char *path)
+{
+	const char *end;
+	size_t used = 0;
+
+	buf[0] = '\0';
+	for (; *path && used < size; path = *end? end + 1 : end) {
+		end = strchr(path, ',');
+		if (!end)
+			end = path + strlen(path);
+
+		used += snprintf(buf + used, size - used, "%s%s%s%.*s",
+				used? "," : "", path[0] == '/'? "" : sdcard_path,
+				path[0] == '/'? "" : "/", (int)(end - path), path);
+	}
+}
+
+static double ms(uint64_t ns)
+{
+	return ns / 1e6;
+}
+
+/* Load once. Returns how long it took, in nanoseconds. */
+static uint64_t run(const char *what)
+{
+	uint64_t start = host_time_ns(), ns;
+	struct sd_stats before = sd_stats;
+
+	warning[0] = '\0';
+	load_stuff();
+	ns = host_time_ns() - start;
+
+	if (!contiguous_buffer) {
+		fprintf(stderr, "%s: loading failed: %s\n", what, warning);
+		exit(1);
+	}
+
+	printf("%-10s %6.1f MiB in %9.1f ms, %7.2f MiB/s, "
+			"%llu commands, %llu seeks%s\n", what,
+			last_load.size / 1048576.0, ms(ns),
+			last_load.size / 1048576.0 / (ns / 1e9),
+			(unsigned long long)(sd_stats.commands + sd_stats.reads -
+				before.commands - before.reads),
+			(unsigned long long)(sd_stats.seeks - before.seeks),
+			last_load.resident? " (resident)" : "");
+	return ns;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t ns, mount_ns, min = ~0ull, max = 0, total = 0;
+	int opt, i, runs = 3;
+	char name[32], *args = "";
+
+	while ((opt = getopt(argc, argv, "n:c:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = atoi(optarg);
+			break;
+		case 'c':
+			args = optarg;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind == argc || argc - optind > 3 || runs < 1)
+		goto usage;
+
+	InitOSFunctionPointers();
+	InitFSFunctionPointers();
+
+	/* Where main.c puts them; load_stuff describes one to Linux */
+	framebuffers[0] = (void *)0xf4000000;
+	framebuffers[1] = (void *)(0xf4000000 + OSScreenGetBufferSizeEx(0));
+
+	fs_init();
+	mount_ns = host_time_ns();
+
+	sd_path(kernel_path, sizeof kernel_path, argv[optind]);
+	if (argc - optind > 1)
+		sd_path(dtb_path, sizeof dtb_path, argv[optind + 1]);
+	if (argc - optind > 2)
+		sd_path(initrd_path, sizeof initrd_path, argv[optind + 2]);
+
+	for (i = 0; i < runs; i++) {
+		/* A different command line each time, so that the resident
+		 * copy of the last run isn't used */
+		snprintf(cmdline, sizeof cmdline, "%s loadbench=%d", args, i);
+		snprintf(name, sizeof name, "run %d", i + 1);
+		ns = run(name);
+
+		total += ns;
+		if (ns < min)
+			min = ns;
+		if (ns > max)
+			max = ns;
+		if (i == 0)
+			printf("bootable after %.1f ms (%.1f ms to mount the SD "
+					"card)\n", ms(mount_ns + ns), ms(mount_ns));
+	}
+
+	if (runs > 1)
+		printf("min/avg/max: %.1f/%.1f/%.1f ms\n",
+				ms(min), ms(total / runs), ms(max));
+
+	run("resident");
+
+	fs_deinit();
+	return 0;
+
+usage:
+	fprintf(stderr, "Usage: %s [-n runs] [-c cmdline] kernel [dtb "
+			"[initrd,...]]\n", argv[0]);
+	return 2;
+}
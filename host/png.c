@@ -0,0 +1,167 @@
+/*
+ * Wii U Linux Launcher -- Host build: PNG screenshots
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Writes uncompressed PNG files: the image data is deflated with "stored"
+ * blocks only, which keeps this short, and makes the output of identical
+ * frames identical.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+
+/* A stored deflate block holds at most this much */
+#define STORED_MAX	0xffff
+
+static uint32_t crc_table[256];
+
+static void init_crc_table(void)
+{
+	uint32_t c;
+	int n, k;
+
+	for (n = 0; n < 256; n++) {
+		c = n;
+		for (k = 0; k < 8; k++)
+			c = (c & 1)? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crc_table[n] = c;
+	}
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len)
+{
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+static void put32(uint8_t *p, uint32_t x)
+{
+	p[0] = x >> 24;
+	p[1] = x >> 16;
+	p[2] = x >> 8;
+	p[3] = x;
+}
+
+static void write_chunk(FILE *fp, const char *type, const uint8_t *data,
+		size_t len)
+{
+	uint8_t buf[4];
+	uint32_t crc;
+
+	put32(buf, len);
+	fwrite(buf, 1, 4, fp);
+	fwrite(type, 1, 4, fp);
+	fwrite(data, 1, len, fp);
+
+	crc = crc32_update(0xffffffff, (const uint8_t *)type, 4);
+	crc = crc32_update(crc, data, len) ^ 0xffffffff;
+	put32(buf, crc);
+	fwrite(buf, 1, 4, fp);
+}
+
+/*
+ * Write a width x height image of big-endian RGBX pixels, pitch pixels per
+ * line, as an RGB PNG file. Returns -1 on error.
+ */
+int png_write(const char *filename, const uint32_t *pixels,
+		unsigned int width, unsigned int height, unsigned int pitch)
+{
+	static const uint8_t signature[8] = {
+		0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+	};
+	size_t row_size = 1 + 3 * (size_t)width;
+	size_t raw_size = row_size * height;
+	size_t nblocks = (raw_size + STORED_MAX - 1) / STORED_MAX;
+	size_t zlen = 2 + raw_size + 5 * nblocks + 4;
+	uint8_t ihdr[13], *raw, *z, *q;
+	uint32_t a = 1, b = 0;
+	unsigned int x, y;
+	size_t i, left;
+	int res = -1;
+	FILE *fp;
+
+	if (!crc_table[1])
+		init_crc_table();
+
+	raw = malloc(raw_size);
+	z = malloc(zlen);
+	if (!raw || !z) {
+		free(raw);
+		free(z);
+		return -1;
+	}
+
+	/* Filter type 0 (none) for every line, then the RGB bytes */
+	for (y = 0, q = raw; y < height; y++) {
+		const uint8_t *line = (const uint8_t *)(pixels + (size_t)y * pitch);
+
+		*q++ = 0;
+		for (x = 0; x < width; x++) {
+			*q++ = line[4 * x];
+			*q++ = line[4 * x + 1];
+			*q++ = line[4 * x + 2];
+		}
+	}
+
+	/* zlib header, stored blocks, Adler-32 */
+	q = z;
+	*q++ = 0x78;
+	*q++ = 0x01;
+	for (i = 0; i < raw_size; i += STORED_MAX) {
+		left = raw_size - i;
+		if (left > STORED_MAX)
+			left = STORED_MAX;
+
+		*q++ = (i + left == raw_size);
+		*q++ = left;
+		*q++ = left >> 8;
+		*q++ = ~left;
+		*q++ = ~left >> 8;
+		memcpy(q, raw + i, left);
+		q += left;
+	}
+	for (i = 0; i < raw_size; i++) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	put32(q, b << 16 | a);
+
+	put32(ihdr, width);
+	put32(ihdr + 4, height);
+	ihdr[8] = 8;		/* bits per sample */
+	ihdr[9] = 2;		/* RGB */
+	ihdr[10] = 0;		/* deflate */
+	ihdr[11] = 0;		/* adaptive filtering */
+	ihdr[12] = 0;		/* no interlacing */
+
+	fp = fopen(filename, "wb");
+	if (fp) {
+		fwrite(signature, 1, sizeof signature, fp);
+		write_chunk(fp, "IHDR", ihdr, sizeof ihdr);
+		write_chunk(fp, "IDAT", z, zlen);
+		write_chunk(fp, "IEND", NULL, 0);
+		res = (fclose(fp) == 0)? 0 : -1;
+	}
+
+	free(raw);
+	free(z);
+	return res;
+}
@@ -0,0 +1,206 @@
+/*
+ * Wii U Linux Launcher -- Host build: how long an SD card takes
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * A simple model of an SD card with a FAT filesystem, which decides how long
+ * each filesystem call takes. It is configured by a profile, a file named by
+ * HOST_SD_PROFILE (see profiles/), with lines like "seq_read = 20M":
+ *
+ *	command_us	the time every command takes: open, stat, close, ...
+ *	max_command	reads and writes are split into commands of this size
+ *	seek_us		extra time for a read or write that doesn't continue
+ *			where the previous one (on the same file) ended
+ *	seq_read	sequential read throughput, in bytes per second
+ *	random_read	throughput after a seek
+ *	write		write throughput
+ *	cluster		the size of a FAT cluster
+ *	cluster_us	extra time for each cluster boundary that is crossed
+ *	slow_write_every, slow_write_us
+ *			every time this many bytes have been written, a write
+ *			takes longer (the card has to erase a block)
+ *
+ * Without a profile, commands take HOST_FS_LATENCY microseconds, and
+ * everything runs at HOST_FS_BANDWIDTH; both default to infinitely fast.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+
+static struct sd_profile {
+	uint64_t command_us;
+	uint64_t max_command;
+	uint64_t seek_us;
+	uint64_t seq_read;
+	uint64_t random_read;
+	uint64_t write;
+	uint64_t cluster;
+	uint64_t cluster_us;
+	uint64_t slow_write_every;
+	uint64_t slow_write_us;
+} profile;
+
+static const struct {
+	const char *name;
+	uint64_t *value;
+} keys[] = {
+	{ "command_us",		&profile.command_us },
+	{ "max_command",	&profile.max_command },
+	{ "seek_us",		&profile.seek_us },
+	{ "seq_read",		&profile.seq_read },
+	{ "random_read",	&profile.random_read },
+	{ "write",		&profile.write },
+	{ "cluster",		&profile.cluster },
+	{ "cluster_us",		&profile.cluster_us },
+	{ "slow_write_every",	&profile.slow_write_every },
+	{ "slow_write_us",	&profile.slow_write_us },
+};
+#define NR_KEYS	(sizeof(keys) / sizeof(keys[0]))
+
+/* Where the last transfer ended */
+static uint64_t last_file, last_end = ~0ull;
+static uint64_t total_written;
+
+struct sd_stats sd_stats;
+
+static void load_profile(const char *name)
+{
+	char line[256], *key, *value, *end;
+	int lineno = 0;
+	size_t i;
+	FILE *fp;
+
+	fp = fopen(name, "r");
+	if (!fp) {
+		perror(name);
+		exit(2);
+	}
+
+	while (fgets(line, sizeof line, fp)) {
+		lineno++;
+		if ((end = strchr(line, '#')))
+			*end = '\0';
+
+		key = strtok(line, " \t\r\n=");
+		if (!key)
+			continue;
+		value = strtok(NULL, " \t\r\n=");
+
+		for (i = 0; i < NR_KEYS; i++)
+			if (!strcmp(keys[i].name, key))
+				break;
+		if (i == NR_KEYS || !value ||
+		    host_parse_number(value, keys[i].value) < 0) {
+			fprintf(stderr, "%s:%d: bad line\n", name, lineno);
+			exit(2);
+		}
+	}
+
+	fclose(fp);
+}
+
+void sd_init(void)
+{
+	const char *name = getenv("HOST_SD_PROFILE");
+	uint64_t bandwidth = host_env_number("HOST_FS_BANDWIDTH", 0);
+
+	profile.command_us = host_env_number("HOST_FS_LATENCY", 0);
+	profile.seq_read = bandwidth;
+	profile.random_read = bandwidth;
+	profile.write = bandwidth;
+
+	if (name)
+		load_profile(name);
+}
+
+static uint64_t transfer_time(uint64_t len, uint64_t rate)
+{
+	return rate? len * 1000000 / rate : 0;
+}
+
+/* The common part of reading and writing */
+static uint64_t access_time(uint64_t file, uint64_t pos, uint64_t len,
+		int *seek)
+{
+	uint64_t us, commands = 1;
+
+	if (profile.max_command && len)
+		commands = (len + profile.max_command - 1) / profile.max_command;
+	us = commands * profile.command_us;
+
+	*seek = (file != last_file || pos != last_end);
+	if (*seek)
+		us += profile.seek_us;
+
+	if (profile.cluster && len)
+		us += ((pos + len - 1) / profile.cluster - pos / profile.cluster) *
+			profile.cluster_us;
+
+	last_file = file;
+	last_end = pos + len;
+	return us;
+}
+
+static void spend(uint64_t us)
+{
+	sd_stats.us += us;
+	host_delay(us);
+}
+
+void sd_command(void)
+{
+	sd_stats.commands++;
+	spend(profile.command_us);
+}
+
+void sd_read(uint64_t file, uint64_t pos, uint64_t len)
+{
+	uint64_t us;
+	int seek;
+
+	us = access_time(file, pos, len, &seek);
+	us += transfer_time(len, seek? profile.random_read : profile.seq_read);
+
+	sd_stats.reads++;
+	sd_stats.seeks += seek;
+	sd_stats.bytes_read += len;
+	spend(us);
+}
+
+void sd_write(uint64_t file, uint64_t pos, uint64_t len)
+{
+	uint64_t us, every = profile.slow_write_every;
+	int seek;
+
+	us = access_time(file, pos, len, &seek);
+	us += transfer_time(len, profile.write);
+
+	if (every && len) {
+		uint64_t slow = (total_written + len) / every - total_written / every;
+
+		us += slow * profile.slow_write_us;
+		sd_stats.slow_writes += slow;
+	}
+	total_written += len;
+
+	sd_stats.writes++;
+	sd_stats.seeks += seek;
+	sd_stats.bytes_written += len;
+	spend(us);
+}
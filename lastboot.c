@@ -0,0 +1,153 @@
+/*
+ * Wii U Linux Launcher -- The last boot's log
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <os_functions.h>
+#include "main.h"
+#include "fs.h"
+#include "hax.h"
+#include "bootlog.h"
+#include "extent.h"
+#include "lastboot.h"
+
+int lastboot_nlines;
+uint32_t lastboot_lost;
+
+static char *text;
+static uint32_t text_len;
+static uint32_t *line_start;
+
+#define FIELD(name)	(BOOTLOG_PHYS + offsetof(struct bootlog, name))
+
+/*
+ * Read len bytes from MEM0: in one go, if buf is physically contiguous, and
+ * a word at a time otherwise
+ */
+static void read_mem0(int fd, uint32_t addr, char *buf, uint32_t len)
+{
+	uint32_t i, word;
+
+	if (extent_is_contiguous(buf, len)) {
+		/* No dirty line may be written back over the copy */
+		DCFlushRange(buf, len);
+		if (iosuhax_kern_memcpy(fd, (uint32_t)OSEffectiveToPhysical(buf),
+				addr, len) >= 0) {
+			DCInvalidateRange(buf, len);
+			return;
+		}
+	}
+
+	for (i = 0; i < len; i += 4) {
+		word = iosuhax_kern_read32(fd, addr + i);
+		buf[i + 0] = word >> 24;
+		buf[i + 1] = word >> 16;
+		buf[i + 2] = word >> 8;
+		buf[i + 3] = word;
+	}
+}
+
+static void split_lines(void)
+{
+	uint32_t i;
+	int n = 1;
+
+	for (i = 0; i < text_len; i++)
+		if (text[i] == '\n' && i + 1 < text_len)
+			n++;
+
+	line_start = xmalloc((n + 1) * sizeof(uint32_t), 4);
+	line_start[0] = 0;
+	for (i = 0, n = 1; i < text_len; i++)
+		if (text[i] == '\n' && i + 1 < text_len)
+			line_start[n++] = i + 1;
+	line_start[n] = text_len;
+
+	lastboot_nlines = n;
+}
+
+static void save_log(void)
+{
+	char path[256];
+	int res;
+
+	snprintf(path, sizeof path, "%s/wiiu/apps/linux/lastboot.log",
+			sdcard_path);
+	res = fs_replace_file(path, (u8 *)text, text_len);
+	if (res < 0)
+		warnf("Failed to write lastboot.log: %s (%d)",
+				FS_strerror(res), res);
+	else
+		warn("The last boot left a log in lastboot.log (Y: show it)");
+}
+
+/*
+ * Look for a boot log in MEM0. If there's a valid one, keep it for the
+ * "last boot" screen, save it to the SD card, and invalidate it, so that it
+ * isn't found again on the next start.
+ */
+void lastboot_fetch(void)
+{
+	uint32_t len, csum;
+	int fd;
+
+	fd = iosuhax_open();
+	if (fd < 0) {
+		/* Nothing to worry about until the user tries to boot */
+		warning[0] = '\0';
+		return;
+	}
+
+	if (iosuhax_kern_read32(fd, FIELD(magic)) != BOOTLOG_MAGIC)
+		goto out;
+
+	len = iosuhax_kern_read32(fd, FIELD(len));
+	csum = iosuhax_kern_read32(fd, FIELD(csum));
+	if (len == 0 || len > BOOTLOG_DATA_SIZE)
+		goto out;
+
+	text = xmalloc((len + 4) & ~3, 0x40);
+	read_mem0(fd, FIELD(data), text, len);
+	if (bootlog_csum(1, text, len) != csum) {
+		xfree(text);
+		text = NULL;
+		goto out;
+	}
+
+	text_len = len;
+	lastboot_lost = iosuhax_kern_read32(fd, FIELD(lost));
+	iosuhax_kern_write32(fd, FIELD(magic), 0);
+
+	split_lines();
+	save_log();
+
+out:
+	iosuhax_close(fd);
+}
+
+/* Line i, without its newline */
+const char *lastboot_line(int i, int *len)
+{
+	uint32_t end = line_start[i + 1];
+
+	if (end > line_start[i] && text[end - 1] == '\n')
+		end--;
+
+	*len = end - line_start[i];
+	return text + line_start[i];
+}
@@ -0,0 +1,32 @@
+/*
+ * Wii U Linux Launcher -- The last boot's log
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _LASTBOOT_H
+#define _LASTBOOT_H
+
+#include <stdint.h>
+
+/* The log that the last boot left in MEM0 (see bootlog.h), split into
+ * lines. lastboot_nlines is 0 if there was none. */
+extern int lastboot_nlines;
+extern uint32_t lastboot_lost;
+
+extern void lastboot_fetch(void);
+extern const char *lastboot_line(int i, int *len);
+
+#endif
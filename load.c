@@ -0,0 +1,1285 @@
+/*
+ * Wii U Linux Launcher -- loading the kernel, the dtb, and the purgatory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <os_functions.h>
+#include "main.h"
+#include "fs.h"
+#include "settings.h"
+#include "fdt.h"
+#include "elf.h"
+#include "fit.h"
+#include "hash.h"
+#include "load.h"
+#include "resident.h"
+#include "arena.h"
+#include "extent.h"
+#include "preflight.h"
+#include "ancast.h"
+#include "boottime.h"
+#include "purgatory/purgatory.h"
+
+/* The purgatory binary, see purgatory/purgatory.h */
+#include "purgatory/purgatory.xxd"
+
+void *contiguous_buffer = NULL;
+struct load_info last_load;
+
+/* Where the purgatory moves a raw kernel image to, and enters it */
+#define KERNEL_LOAD_ADDR	0x00000000
+
+#define MEM1_BASE	0xf4000000
+#define MEM1_SIZE	0x02000000
+
+#define MIN(a, b)	(((a) < (b))? (a) : (b))
+#define ALIGN(x, a)	(((x) + (a) - 1) & ~((a) - 1))
+
+/* How much of the end of MEM1 is free: everything above the ancast image,
+ * which is above the framebuffers */
+#define MEM1_SPACE	(MEM1_BASE + MEM1_SIZE - \
+			 ((uint32_t)ANCAST_ADDR + ANCAST_MAX_SIZE))
+
+/* Get a chunk of MEM1 */
+static void *get_mem1_chunk(size_t size)
+{
+	size = ALIGN(size, 0x1000);
+
+	if (size > MEM1_SPACE) {
+		warnf("ERROR: Can't allocate %#x bytes from MEM1", size);
+		return NULL;
+	}
+
+	return (void *) (MEM1_BASE + MEM1_SIZE - size);
+}
+
+/* Get room for an initrd that doesn't fit into MEM1 */
+static void *get_mem2_chunk(size_t size)
+{
+	/* The copies of other images have to make room, if necessary */
+	while (arena_reserve(size) < 0) {
+		if (resident_drop_lru() < 0) {
+			warnf("ERROR: Can't allocate %#x bytes from MEM2", size);
+			return NULL;
+		}
+	}
+
+	return arena_alloc(size, 0x1000);
+}
+
+/* How much the devicetree may grow when it is patched */
+#define DTB_SLACK	0x4000
+
+/*
+ * The framebuffers, as Linux's simple-framebuffer binding describes them.
+ * OSScreen pixels are R, G, B, X in memory. The binding's format names are
+ * DRM fourccs, which are defined by the byte order in memory, whatever the
+ * CPU's endianness: a8b8g8r8 (DRM_FORMAT_ABGR8888) is R, G, B, A, and that
+ * is how simpledrm reads it on a big-endian kernel, too. The older fbdev
+ * driver (simplefb) takes the name as bit offsets in a native word instead,
+ * which swaps the channels on big-endian; its table has no name for this
+ * layout there, so a8b8g8r8 is still the best description.
+ */
+static const struct {
+	uint32_t width, height, stride;
+} screens[2] = {
+	{ 1280, 720, 1280 * 4 },	/* TV */
+	{  854, 480,  896 * 4 },	/* DRC */
+};
+
+/*
+ * Offsets change whenever the blob is modified, so these look the node up
+ * by its path every time.
+ */
+static int add_node(void *dtb, size_t bufsize, const char *parent,
+		const char *name)
+{
+	int node = fdt_path_offset(dtb, parent);
+
+	return (node < 0)? node : fdt_add_subnode(dtb, bufsize, node, name);
+}
+
+static int set_prop(void *dtb, size_t bufsize, const char *path,
+		const char *name, const void *value, int len)
+{
+	int node = fdt_path_offset(dtb, path);
+
+	return (node < 0)? node : fdt_setprop(dtb, bufsize, node, name,
+			value, len);
+}
+
+static int set_string(void *dtb, size_t bufsize, const char *path,
+		const char *name, const char *value)
+{
+	int node = fdt_path_offset(dtb, path);
+
+	return (node < 0)? node : fdt_setprop_string(dtb, bufsize, node, name,
+			value);
+}
+
+static int set_cells(void *dtb, size_t bufsize, const char *path,
+		const char *name, const uint32_t *cells, int count)
+{
+	int node = fdt_path_offset(dtb, path);
+
+	return (node < 0)? node : fdt_setprop_cells(dtb, bufsize, node, name,
+			cells, count);
+}
+
+/*
+ * Describe the visible half of a framebuffer in a simple-framebuffer node,
+ * so that Linux has a console before its own display driver is up, and
+ * reserve it, so that Linux doesn't allocate memory from it.
+ */
+static int add_simplefb(void *dtb, size_t bufsize, int screen)
+{
+	uint32_t reg[2], one = 1;
+	char name[32], path[64];
+	int res = 0;
+
+	reg[0] = (uint32_t)OSEffectiveToPhysical(framebuffers[screen]);
+	reg[1] = screens[screen].stride * screens[screen].height;
+	snprintf(name, sizeof(name), "framebuffer@%x", reg[0]);
+
+	if (fdt_path_offset(dtb, "/reserved-memory") == FDT_ERR_NOTFOUND) {
+		res = add_node(dtb, bufsize, "/", "reserved-memory");
+		if (res >= 0)
+			res = set_cells(dtb, bufsize, "/reserved-memory",
+					"#address-cells", &one, 1);
+		if (res >= 0)
+			res = set_cells(dtb, bufsize, "/reserved-memory",
+					"#size-cells", &one, 1);
+		if (res >= 0)
+			res = set_prop(dtb, bufsize, "/reserved-memory",
+					"ranges", NULL, 0);
+	}
+
+	snprintf(path, sizeof(path), "/reserved-memory/%s", name);
+	if (res >= 0)
+		res = add_node(dtb, bufsize, "/reserved-memory", name);
+	if (res >= 0)
+		res = set_cells(dtb, bufsize, path, "reg", reg, 2);
+	if (res >= 0)
+		res = set_prop(dtb, bufsize, path, "no-map", NULL, 0);
+
+	snprintf(path, sizeof(path), "/chosen/%s", name);
+	if (res >= 0)
+		res = add_node(dtb, bufsize, "/chosen", name);
+	if (res >= 0)
+		res = set_string(dtb, bufsize, path, "compatible",
+				"simple-framebuffer");
+	if (res >= 0)
+		res = set_cells(dtb, bufsize, path, "reg", reg, 2);
+	if (res >= 0)
+		res = set_cells(dtb, bufsize, path, "width",
+				&screens[screen].width, 1);
+	if (res >= 0)
+		res = set_cells(dtb, bufsize, path, "height",
+				&screens[screen].height, 1);
+	if (res >= 0)
+		res = set_cells(dtb, bufsize, path, "stride",
+				&screens[screen].stride, 1);
+	if (res >= 0)
+		res = set_string(dtb, bufsize, path, "format", "a8b8g8r8");
+
+	return res;
+}
+
+/*
+ * Add the things that Linux needs to know about to the devicetree. screen
+ * is the framebuffer to describe, or -1.
+ */
+static int patch_dtb(void *dtb, size_t bufsize, uint32_t initrd_start,
+		uint32_t initrd_end, int screen)
+{
+	uint32_t boottime[2] = { BOOTTIME_PHYS, BOOTTIME_SIZE };
+	int chosen, res;
+
+	res = fdt_check_header(dtb);
+	if (res < 0) {
+		warn("The dtb is not a valid devicetree blob");
+		return res;
+	}
+
+	chosen = fdt_path_offset(dtb, "/chosen");
+	if (chosen == FDT_ERR_NOTFOUND)
+		chosen = fdt_add_subnode(dtb, bufsize, 0, "chosen");
+	if (chosen < 0)
+		goto err;
+
+	res = fdt_setprop_cells(dtb, bufsize, chosen, "wiiu,boot-timing",
+			boottime, 2);
+	if (res < 0)
+		goto err;
+
+	/* Without a cmdline, the dtb's own bootargs (if any) are kept */
+	if (cmdline[0]) {
+		chosen = fdt_path_offset(dtb, "/chosen");
+		res = fdt_setprop_string(dtb, bufsize, chosen, "bootargs",
+				cmdline);
+		if (res < 0)
+			goto err;
+	}
+
+	if (initrd_end > initrd_start) {
+		res = fdt_setprop_cells(dtb, bufsize, chosen,
+				"linux,initrd-start", &initrd_start, 1);
+		if (res < 0)
+			goto err;
+
+		/* Changing a property can move the nodes around */
+		chosen = fdt_path_offset(dtb, "/chosen");
+		res = fdt_setprop_cells(dtb, bufsize, chosen,
+				"linux,initrd-end", &initrd_end, 1);
+		if (res < 0)
+			goto err;
+	}
+
+	if (screen >= 0) {
+		res = add_simplefb(dtb, bufsize, screen);
+		if (res < 0)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	res = (chosen < 0)? chosen : res;
+	warnf("Patching the dtb failed: %s (%d)", fdt_strerror(res), res);
+	return res;
+}
+
+/*
+ * The kernel is loaded in pieces: Where its destination is free while the
+ * launcher is still running, it is read from the SD card straight into
+ * place. The rest (where the framebuffers or the ancast image are) is staged
+ * in the contiguous buffer, and moved into place by the purgatory. Nothing
+ * may go outside of MEM1, where the purgatory would overwrite whatever is
+ * there, unchecked.
+ */
+struct piece {
+	uint32_t offset;	/* in the file */
+	uint32_t dest;		/* physical address */
+	uint32_t filesz;
+	uint32_t memsz;
+	int staged;
+	uint32_t buf_offset;	/* in the contiguous buffer, if staged */
+};
+
+#define MAX_PIECES	(3 * ELF_MAX_SEGMENTS)
+
+struct range {
+	uint32_t start, end;
+};
+
+/* The physical memory that can't be written while the launcher runs */
+static int get_reserved_ranges(struct range *r)
+{
+	r[0].start = 0;
+	r[0].end = OSScreenGetBufferSizeEx(0) + OSScreenGetBufferSizeEx(1);
+	r[1].start = (uint32_t)ANCAST_ADDR - MEM1_BASE;
+	r[1].end = r[1].start + ANCAST_MAX_SIZE;
+
+	return 2;
+}
+
+/* Split a segment at the borders of the reserved ranges */
+static int plan_segment(const struct elf_segment *seg, struct piece *pieces,
+		int n)
+{
+	struct range reserved[2];
+	int nreserved = get_reserved_ranges(reserved);
+	uint32_t pos = seg->paddr, end = seg->paddr + seg->memsz;
+	uint32_t file_end = seg->paddr + seg->filesz;
+	uint32_t next;
+	int i, staged;
+
+	if (end < pos) {
+		warn("A kernel segment wraps around the address space");
+		return -1;
+	}
+
+	if (end > MEM1_SIZE) {
+		warnf("A kernel segment (%#x-%#x) is outside of MEM1", pos,
+				end);
+		return -1;
+	}
+
+	while (pos < end) {
+		next = end;
+		staged = 0;
+
+		for (i = 0; i < nreserved; i++) {
+			if (pos >= reserved[i].start && pos < reserved[i].end) {
+				staged = 1;
+				next = MIN(next, reserved[i].end);
+			} else if (reserved[i].start > pos) {
+				next = MIN(next, reserved[i].start);
+			}
+		}
+
+		if (n == MAX_PIECES) {
+			warn("The kernel has too many segments");
+			return -1;
+		}
+
+		pieces[n].offset = seg->offset + (pos - seg->paddr);
+		pieces[n].dest = pos;
+		pieces[n].filesz = (pos < file_end)? MIN(next, file_end) - pos : 0;
+		pieces[n].memsz = next - pos;
+		pieces[n].staged = staged;
+		n++;
+
+		pos = next;
+	}
+
+	return n;
+}
+
+/*
+ * Where the kernel, the dtb, and the initrd are read from: Either separate
+ * files, or parts of one FIT image. In the latter case, fit points to the
+ * image description, and its hashes are checked while the data is read.
+ */
+struct source {
+	int handle;
+	uint32_t offset;
+	uint32_t size;
+	const struct fit_image *fit;
+};
+
+static uint8_t scratch[0x1000] __attribute__((aligned(0x40)));
+
+/*
+ * Verification of FIT images. The data is hashed in file order, as it is
+ * read. Parts of an image that are not loaded (e.g. the non-loadable sections
+ * of an ELF kernel) are read into the scratch buffer, only to hash them.
+ */
+struct verifier {
+	const struct fit_image *img;
+	struct hash hashes[FIT_MAX_HASHES];
+	uint32_t pos;		/* everything before this has been hashed */
+};
+
+static void verify_start(struct verifier *v, const struct source *src)
+{
+	int i;
+
+	v->img = src->fit;
+	v->pos = src->offset;
+
+	if (v->img)
+		for (i = 0; i < v->img->nhashes; i++)
+			hash_init(&v->hashes[i], v->img->hashes[i].algo);
+}
+
+static void verify_update(struct verifier *v, const uint8_t *data, uint32_t len)
+{
+	int i;
+
+	for (i = 0; i < v->img->nhashes; i++)
+		hash_update(&v->hashes[i], data, len);
+	v->pos += len;
+}
+
+/* Hash everything up to offset that hasn't been hashed yet */
+static int verify_skip_to(struct verifier *v, int handle, uint32_t offset)
+{
+	uint32_t n;
+	int res;
+
+	while (v->pos < offset) {
+		n = MIN(offset - v->pos, sizeof(scratch));
+		res = fs_read_at(handle, scratch, n, v->pos, NULL);
+		if (res < 0)
+			return res;
+		if (res != n)
+			return -1;
+		verify_update(v, scratch, n);
+	}
+
+	return 0;
+}
+
+/* Data at offset has been read to data. Offsets must not decrease. */
+static int verify_data(struct verifier *v, int handle, uint32_t offset,
+		const uint8_t *data, uint32_t len)
+{
+	uint32_t skip;
+	int res;
+
+	if (!v->img)
+		return 0;
+
+	res = verify_skip_to(v, handle, offset);
+	if (res < 0)
+		return res;
+
+	/* Some of the data may already have been hashed */
+	skip = v->pos - offset;
+	if (skip < len)
+		verify_update(v, data + skip, len - skip);
+
+	return 0;
+}
+
+static int verify_finish(struct verifier *v, int handle, const char *what)
+{
+	uint8_t digest[HASH_MAX_SIZE];
+	int i, res;
+
+	if (!v->img)
+		return 0;
+
+	res = verify_skip_to(v, handle, v->img->offset + v->img->size);
+	if (res < 0) {
+		warnf("Reading %s for verification failed", what);
+		return -1;
+	}
+
+	for (i = 0; i < v->img->nhashes; i++) {
+		hash_final(&v->hashes[i], digest);
+		if (memcmp(digest, v->img->hashes[i].value,
+				hash_size(v->img->hashes[i].algo)) != 0) {
+			warnf("The %s is corrupted (hash mismatch)", what);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Read a whole source into a buffer, and verify it */
+static int load_source(const struct source *src, uint8_t *dest,
+		const char *what)
+{
+	struct verifier v;
+	int res;
+
+	if (src->size == 0)
+		return 0;
+
+	warnf("Loading %s...", what);
+	draw_gui();
+
+	res = fs_read_at(src->handle, dest, src->size, src->offset, what);
+	if (res < 0)
+		return res;
+	if (res != src->size) {
+		warnf("The %s file is truncated", what);
+		return -1;
+	}
+
+	verify_start(&v, src);
+	res = verify_data(&v, src->handle, src->offset, dest, src->size);
+	if (res == 0)
+		res = verify_finish(&v, src->handle, what);
+	if (res < 0)
+		return res;
+
+	warn("");
+	return 0;
+}
+
+/*
+ * Read the ELF and program headers (or find out that the kernel is a raw
+ * image), and turn the segments into pieces, sorted by their offset in the
+ * file.
+ */
+static int plan_kernel(const struct source *src, struct piece *pieces,
+		uint32_t *entry)
+{
+	const struct fit_image *fit = src->fit;
+	uint32_t load;
+	struct elf_image img;
+	struct piece tmp;
+	int i, j, n, res;
+
+	res = fs_read_at(src->handle, scratch, MIN(src->size, sizeof(scratch)),
+			src->offset, "kernel");
+	if (res < 0)
+		return res;
+
+	if (elf_is_elf(scratch, res)) {
+		res = elf_parse(scratch, res, &img);
+		if (res < 0) {
+			warnf("Can't load the kernel: %s", elf_strerror(res));
+			return res;
+		}
+	} else {
+		/* A FIT image may say where a raw kernel goes */
+		load = (fit && fit->has_load)? fit->load : KERNEL_LOAD_ADDR;
+
+		img.entry = (fit && fit->has_entry)? fit->entry : load;
+		img.nsegments = 1;
+		img.segments[0].offset = 0;
+		img.segments[0].paddr = load;
+		img.segments[0].filesz = src->size;
+		img.segments[0].memsz = src->size;
+	}
+
+	for (i = 0, n = 0; i < img.nsegments; i++) {
+		if (img.segments[i].offset + img.segments[i].filesz > src->size) {
+			warn("The kernel file is truncated");
+			return -1;
+		}
+
+		img.segments[i].offset += src->offset;
+		n = plan_segment(&img.segments[i], pieces, n);
+		if (n < 0)
+			return n;
+	}
+
+	for (i = 1; i < n; i++) {
+		tmp = pieces[i];
+		for (j = i; j > 0 && pieces[j - 1].offset > tmp.offset; j--)
+			pieces[j] = pieces[j - 1];
+		pieces[j] = tmp;
+	}
+
+	*entry = img.entry;
+	return n;
+}
+
+/* Read the pieces into place, or into the buffer */
+static int load_pieces(const struct source *src, struct piece *pieces, int n,
+		uint8_t *buffer)
+{
+	struct verifier v;
+	struct piece *p;
+	uint8_t *dest;
+	int i, res;
+
+	warn("Loading kernel...");
+	draw_gui();
+
+	verify_start(&v, src);
+
+	for (i = 0; i < n; i++) {
+		p = &pieces[i];
+		if (p->staged)
+			dest = buffer + p->buf_offset;
+		else
+			dest = (uint8_t *)MEM1_BASE + p->dest;
+
+		res = fs_read_at(src->handle, dest, p->filesz, p->offset,
+				"kernel");
+		if (res < 0)
+			return res;
+		if (res != p->filesz) {
+			warn("The kernel file is truncated");
+			return -1;
+		}
+
+		if (p->filesz) {
+			res = verify_data(&v, src->handle, p->offset, dest,
+					p->filesz);
+			if (res < 0)
+				return res;
+		}
+
+		/* The purgatory clears the BSS of the staged pieces */
+		if (!p->staged) {
+			memset(dest + p->filesz, 0, p->memsz - p->filesz);
+			DCFlushRange(dest, p->memsz);
+		}
+	}
+
+	res = verify_finish(&v, src->handle, "kernel");
+	if (res < 0)
+		return res;
+
+	warn("");
+	return 0;
+}
+
+/* Open a file as a source. An empty path is not an error, but yields an
+ * empty source. */
+static int open_file(struct source *src, const char *path, const char *what)
+{
+	src->handle = -1;
+	src->offset = 0;
+	src->size = 0;
+	src->fit = NULL;
+
+	if (path[0] == '\0')
+		return 0;
+
+	src->size = get_file_size(path, what);
+	if (src->size == 0)
+		return -1;
+
+	src->handle = fs_open_file(path, what);
+	return (src->handle < 0)? src->handle : 0;
+}
+
+/* The index of a FIT image is only read, so it shouldn't be large */
+#define FIT_MAX_INDEX	0x100000
+
+static struct fit_config fit_config;
+
+/*
+ * The kernel may be given as a FIT image, optionally followed by
+ * #configuration, as with U-Boot's bootm. The configuration's fdt takes the
+ * place of the dtb file, and its ramdisk goes in front of the initrd files.
+ */
+static int open_sources(struct source *kernel, struct source *dtb,
+		struct source *initrd)
+{
+	char path[sizeof(kernel_path)];
+	const char *fit_name = NULL;
+	uint32_t index_size;
+	char *hash;
+	void *index;
+	int res;
+
+	strcpy(path, kernel_path);
+	hash = strrchr(path, '#');
+	if (hash && !strchr(hash, '/')) {
+		*hash = '\0';
+		fit_name = hash + 1;
+	}
+
+	res = open_file(kernel, path, "kernel");
+	if (res < 0)
+		return res;
+
+	res = fs_read_at(kernel->handle, scratch, 8, 0, "kernel");
+	if (res < 0)
+		return res;
+
+	if (res == 8 && fdt_get32(scratch) == FDT_MAGIC) {
+		index_size = fdt_get32(scratch + 4);
+		if (index_size > FIT_MAX_INDEX || index_size > kernel->size) {
+			warn("The FIT image's index is too big");
+			return -1;
+		}
+		if (index_size < FDT_HEADER_SIZE) {
+			warn("The FIT image's index is too small");
+			return -1;
+		}
+
+		index = xmalloc(index_size, 0x40);
+		res = fs_read_at(kernel->handle, index, index_size, 0, "kernel");
+		if (res >= 0)
+			res = fit_parse(index, fit_name, &fit_config);
+		xfree(index);
+		if (res < 0) {
+			warnf("Bad FIT image: %s", fit_strerror(res));
+			return res;
+		}
+
+		kernel->offset = fit_config.kernel.offset;
+		kernel->size = fit_config.kernel.size;
+		kernel->fit = &fit_config.kernel;
+	} else if (fit_name) {
+		warn("Only FIT images have configurations");
+		return -1;
+	}
+
+	if (kernel->fit && fit_config.fdt.present) {
+		*dtb = *kernel;
+		dtb->offset = fit_config.fdt.offset;
+		dtb->size = fit_config.fdt.size;
+		dtb->fit = &fit_config.fdt;
+	} else {
+		res = open_file(dtb, dtb_path, "dtb");
+		if (res < 0)
+			return res;
+		if (dtb->size == 0) {
+			warn("You need to specify a dtb!");
+			return -1;
+		}
+	}
+
+	if (kernel->fit && fit_config.ramdisk.present) {
+		*initrd = *kernel;
+		initrd->offset = fit_config.ramdisk.offset;
+		initrd->size = fit_config.ramdisk.size;
+		initrd->fit = &fit_config.ramdisk;
+	} else {
+		initrd->handle = -1;
+		initrd->offset = 0;
+		initrd->size = 0;
+		initrd->fit = NULL;
+	}
+
+	return 0;
+}
+
+static void close_sources(struct source *kernel, struct source *dtb)
+{
+	if (dtb->handle >= 0 && dtb->handle != kernel->handle)
+		fs_close_file(dtb->handle);
+	if (kernel->handle >= 0)
+		fs_close_file(kernel->handle);
+}
+
+/*
+ * initrd_path may list several files, separated by commas. They are loaded
+ * back to back (after the FIT image's ramdisk, if any), each one starting at
+ * a multiple of four bytes, as the kernel expects for concatenated cpio
+ * archives. The gaps are filled with zeros.
+ */
+#define MAX_INITRDS	8
+
+struct initrd_list {
+	char paths[sizeof(initrd_path)];
+	const char *files[MAX_INITRDS];
+	uint32_t sizes[MAX_INITRDS];
+	int count;
+	uint32_t total_size;
+};
+
+static int get_initrd_sizes(struct initrd_list *list, uint32_t fit_size)
+{
+	char *p = list->paths, *end;
+	int i;
+
+	strcpy(list->paths, initrd_path);
+	list->count = 0;
+	list->total_size = ALIGN(fit_size, 4);
+
+	while (*p) {
+		/* Cut out the next path, without surrounding spaces */
+		end = strchr(p, ',');
+		if (end)
+			*end = '\0';
+		while (*p == ' ')
+			p++;
+		for (i = strlen(p); i > 0 && p[i - 1] == ' '; i--)
+			p[i - 1] = '\0';
+
+		if (*p) {
+			if (list->count == MAX_INITRDS) {
+				warn("Too many initrd files");
+				return -1;
+			}
+
+			list->files[list->count] = p;
+			list->sizes[list->count] = get_file_size(p, "initrd");
+			if (list->sizes[list->count] == 0)
+				return -1;
+
+			list->total_size += ALIGN(list->sizes[list->count], 4);
+			list->count++;
+		}
+
+		if (!end)
+			break;
+		p = end + 1;
+	}
+
+	return 0;
+}
+
+static int load_initrds(const struct source *fit_initrd,
+		const struct initrd_list *list, uint8_t *dest)
+{
+	uint32_t pos;
+	int i, res;
+
+	res = load_source(fit_initrd, dest, "initrd");
+	if (res < 0)
+		return res;
+	pos = fit_initrd->size;
+
+	for (i = 0; i < list->count; i++) {
+		memset(dest + pos, 0, ALIGN(pos, 4) - pos);
+		pos = ALIGN(pos, 4);
+
+		res = read_file_into_buffer(list->files[i], dest + pos,
+				list->sizes[i], "initrd");
+		if (res < 0)
+			return res;
+		if (res != list->sizes[i]) {
+			warnf("%s is truncated", list->files[i]);
+			return -1;
+		}
+		pos += list->sizes[i];
+	}
+
+	memset(dest + pos, 0, list->total_size - pos);
+	return 0;
+}
+
+/* Read the start of a file (or of an image in a FIT image) into scratch */
+static int read_header(int handle, uint32_t offset, uint32_t size,
+		const char *what)
+{
+	return fs_read_at(handle, scratch, MIN(size, PREFLIGHT_HEADER_SIZE),
+			offset, what);
+}
+
+static int read_file_header(const char *path, uint32_t size, const char *what)
+{
+	int handle, res;
+
+	handle = fs_open_file(path, what);
+	if (handle < 0)
+		return handle;
+
+	res = read_header(handle, 0, size, what);
+	fs_close_file(handle);
+	return res;
+}
+
+/*
+ * Check that the dtb, the initrds and the ancast image look like what they
+ * should be, by reading only their headers, before anything big is read.
+ */
+static int preflight(const struct source *dtb, const struct source *initrd,
+		const struct initrd_list *list)
+{
+	uint32_t size;
+	int i, res;
+
+	res = read_header(dtb->handle, dtb->offset, dtb->size, "dtb");
+	if (res < 0)
+		return res;
+	res = preflight_dtb(scratch, res, dtb->size);
+	if (res < 0) {
+		warnf("Bad dtb: %s", preflight_strerror(res));
+		return res;
+	}
+
+	if (initrd->size) {
+		res = read_header(initrd->handle, initrd->offset, initrd->size,
+				"initrd");
+		if (res < 0)
+			return res;
+		res = preflight_initrd(scratch, res);
+		if (res < 0) {
+			warnf("Bad initrd: %s", preflight_strerror(res));
+			return res;
+		}
+	}
+
+	for (i = 0; i < list->count; i++) {
+		res = read_file_header(list->files[i], list->sizes[i],
+				"initrd");
+		if (res < 0)
+			return res;
+		res = preflight_initrd(scratch, res);
+		if (res < 0) {
+			warnf("Bad initrd %s: %s", list->files[i],
+					preflight_strerror(res));
+			return res;
+		}
+	}
+
+	/* The ARM checks it too, but only when there's no way back */
+	if (ancast_check_mlc() == 0)
+		return 0;
+	size = get_file_size(ANCAST_PATH, "ancast image");
+	res = read_file_header(ANCAST_PATH, size, "ancast image");
+	if (res < 0)
+		return res;
+	res = preflight_ancast(scratch, res, size);
+	if (res < 0) {
+		warnf("Bad ancast image: %s", preflight_strerror(res));
+		return res;
+	}
+
+	return 0;
+}
+
+/*
+ * Hash the name, size and modification time of each file in a
+ * comma-separated list, ignoring a FIT configuration name.
+ */
+static void hash_files(struct hash *h, const char *paths)
+{
+	char buf[sizeof(kernel_path)], *p = buf, *end, *hash;
+	FSStat stat;
+
+	strcpy(buf, paths);
+	while (*p) {
+		end = strchr(p, ',');
+		if (end)
+			*end = '\0';
+		while (*p == ' ')
+			p++;
+		hash = strrchr(p, '#');
+		if (hash && !strchr(hash, '/'))
+			*hash = '\0';
+
+		hash_update(h, p, strlen(p) + 1);
+		if (*p && fs_stat(p, &stat) >= 0) {
+			hash_update(h, &stat.size, sizeof(stat.size));
+			hash_update(h, &stat.mtime, sizeof(stat.mtime));
+		}
+
+		if (!end)
+			break;
+		p = end + 1;
+	}
+}
+
+/* Identify what load_stuff would load, without reading any file */
+static void get_fingerprint(uint8_t *fingerprint)
+{
+	struct hash h;
+
+	hash_init(&h, HASH_SHA1);
+	hash_files(&h, kernel_path);
+	hash_files(&h, dtb_path);
+	hash_files(&h, initrd_path);
+	hash_update(&h, cmdline, strlen(cmdline) + 1);
+	hash_final(&h, fingerprint);
+}
+
+static uint32_t ms_since(uint64_t start)
+{
+	return (OSGetTime() - start) / (TIMER_CLOCK / 1000);
+}
+
+/* Take an image that is still in MEM2, instead of reading the files */
+static int restore_resident(const uint8_t *fingerprint, uint64_t start)
+{
+	int slot = resident_find(fingerprint);
+
+	if (slot < 0)
+		return -1;
+
+	last_load.size = resident_restore(slot, &contiguous_buffer);
+	last_load.ms = ms_since(start);
+	last_load.resident = 1;
+	return 0;
+}
+
+/* Keep a copy of everything that load_stuff put into MEM1 */
+static void store_resident(const uint8_t *fingerprint, uint8_t *buffer,
+		size_t total_size, const struct piece *pieces, int n)
+{
+	struct resident_region regions[RESIDENT_MAX_REGIONS];
+	int i, nregions = 0;
+
+	regions[nregions].addr = buffer;
+	regions[nregions].size = total_size;
+	nregions++;
+
+	for (i = 0; i < n && nregions < RESIDENT_MAX_REGIONS; i++) {
+		if (pieces[i].staged)
+			continue;
+		regions[nregions].addr = (uint8_t *)MEM1_BASE + pieces[i].dest;
+		regions[nregions].size = pieces[i].memsz;
+		nregions++;
+	}
+
+	resident_store(fingerprint, current_entry, buffer, regions, nregions);
+}
+
+/* How scattered the buffer may be in physical memory */
+#define MAX_EXTENTS	32
+
+static struct extent extents[MAX_EXTENTS];
+
+/*
+ * Describe a staged piece to the purgatory, with one segment for each
+ * physical extent that its copy in the buffer spans. With hdr == NULL, the
+ * segments are only counted. Returns the new number of segments.
+ */
+static int add_segments(struct purgatory_header *hdr, int nsegments,
+		const struct piece *piece, const uint8_t *buffer, int nextents)
+{
+	const uint8_t *start = buffer + piece->buf_offset;
+	const uint8_t *end = start + piece->filesz, *from, *to;
+	struct purgatory_segment *seg = NULL;
+	int i;
+
+	for (i = 0; i < nextents; i++) {
+		from = extents[i].addr;
+		to = from + extents[i].size;
+		if (from < start)
+			from = start;
+		if (to > end)
+			to = end;
+		if (from >= to)
+			continue;
+
+		if (hdr) {
+			seg = &hdr->segments[nsegments];
+			seg->src = extents[i].phys + (from - extents[i].addr);
+			seg->dest = piece->dest + (from - start);
+			seg->filesz = to - from;
+			seg->memsz = to - from;
+			seg->csum = purgatory_csum(from, to - from);
+		}
+		nsegments++;
+	}
+
+	/* Only zeroes; nothing needs to be copied */
+	if (piece->filesz == 0) {
+		if (hdr) {
+			seg = &hdr->segments[nsegments];
+			seg->src = piece->dest;
+			seg->dest = piece->dest;
+			seg->filesz = 0;
+			seg->memsz = 0;
+			seg->csum = purgatory_csum(start, 0);
+		}
+		nsegments++;
+	}
+
+	/* The last segment zeroes the rest of the piece */
+	if (seg)
+		seg->memsz += piece->memsz - piece->filesz;
+
+	return nsegments;
+}
+
+/*
+ * Find out how the buffer is laid out in physical memory, before anything
+ * is read into it. Linux gets the dtb and the initrd as one range each, and
+ * the purgatory runs from the start of the buffer, so those have to be
+ * physically contiguous; the staged pieces can be gathered from anywhere.
+ * Returns the number of extents, or -1.
+ */
+static int map_buffer(uint8_t *buffer, size_t total_size, size_t purgatory_size,
+		const uint8_t *dtb_buf, size_t dtb_bufsize,
+		const uint8_t *initrd_buf, size_t initrd_size)
+{
+	int nextents;
+
+	nextents = extent_walk(buffer, total_size, extents, MAX_EXTENTS);
+	if (nextents < 0) {
+		warn("The buffer is too fragmented in physical memory");
+		return -1;
+	}
+
+	if (!extent_is_contiguous(buffer, purgatory_size) ||
+	    !extent_is_contiguous(dtb_buf, dtb_bufsize) ||
+	    !extent_is_contiguous(initrd_buf, initrd_size)) {
+		warn("The buffer is not physically contiguous");
+		return -1;
+	}
+
+	return nextents;
+}
+
+/* Whether none of the kernel's pieces is moved over a framebuffer */
+static int screen_is_free(const struct piece *pieces, int n, int screen)
+{
+	uint32_t start, end;
+	int i;
+
+	start = (uint32_t)OSEffectiveToPhysical(framebuffers[screen]);
+	end = start + screens[screen].stride * screens[screen].height;
+
+	for (i = 0; i < n; i++)
+		if (pieces[i].dest + pieces[i].memsz > start &&
+		    pieces[i].dest < end)
+			return 0;
+
+	return 1;
+}
+
+/*
+ * Pick a framebuffer that Linux can keep showing: one that the kernel isn't
+ * moved over. The TV is preferred, because the ARM draws the memory console
+ * on the gamepad. Returns -1 if there is no such framebuffer.
+ */
+static int pick_screen(const struct piece *pieces, int n)
+{
+	int screen;
+
+	for (screen = 0; screen < 2; screen++)
+		if (screen_is_free(pieces, n, screen))
+			return screen;
+
+	return -1;
+}
+
+/* https://www.kernel.org/doc/Documentation/devicetree/booting-without-of.txt */
+int load_stuff(void)
+{
+	size_t purgatory_size = purgatory_bin_len;
+	static struct initrd_list initrds;
+	struct source kernel, dtb, initrd;
+	struct piece pieces[MAX_PIECES];
+	uint32_t entry, initrd_phys;
+	uint8_t fingerprint[HASH_MAX_SIZE];
+	uint64_t start = OSGetTime();
+	size_t total_size, offset;
+	uint8_t *buffer, *initrd_buf;
+	int i, j, n, nsegments, nextents, res, initrd_in_mem2, screen;
+
+	contiguous_buffer = NULL;
+
+	if (kernel_path[0] == '\0') {
+		warn("You need to specify a kernel!");
+		return 0;
+	}
+
+	get_fingerprint(fingerprint);
+	if (restore_resident(fingerprint, start) == 0)
+		return 0;
+
+	dtb.handle = -1;
+	res = open_sources(&kernel, &dtb, &initrd);
+	if (res < 0)
+		goto out;
+
+	/* Size the initrd region up front, so the dtb can point to it */
+	res = get_initrd_sizes(&initrds, initrd.size);
+	if (res < 0)
+		goto out;
+
+	res = preflight(&dtb, &initrd, &initrds);
+	if (res < 0)
+		goto out;
+
+	n = plan_kernel(&kernel, pieces, &entry);
+	if (n < 0) {
+		res = n;
+		goto out;
+	}
+
+	/* Lay out the buffer: purgatory, staged pieces, dtb, initrd */
+	offset = ALIGN(purgatory_size, 0x1000);
+	for (i = 0; i < n; i++) {
+		if (!pieces[i].staged)
+			continue;
+		pieces[i].buf_offset = offset;
+		offset = ALIGN(offset + pieces[i].filesz, 0x1000);
+	}
+
+	size_t dtb_offset = offset;
+	size_t dtb_bufsize = dtb.size + DTB_SLACK;
+	size_t initrd_offset = ALIGN(dtb_offset + dtb_bufsize, 0x1000);
+
+	/* If everything doesn't fit into MEM1, the initrd goes to MEM2 */
+	total_size = initrd_offset + initrds.total_size;
+	initrd_in_mem2 = (initrds.total_size && total_size > MEM1_SPACE);
+	if (initrd_in_mem2)
+		total_size = initrd_offset;
+
+	buffer = get_mem1_chunk(total_size);
+	if (!buffer) {
+		res = -1;
+		goto out;
+	}
+
+	if (initrd_in_mem2) {
+		initrd_buf = get_mem2_chunk(initrds.total_size);
+		if (!initrd_buf) {
+			res = -1;
+			goto out;
+		}
+	} else {
+		/* Leave the MEM2 heap to the copies of loaded images */
+		arena_release();
+		initrd_buf = buffer + initrd_offset;
+	}
+	initrd_phys = (uint32_t)OSEffectiveToPhysical(initrd_buf);
+
+	nextents = map_buffer(buffer, total_size, purgatory_size,
+			buffer + dtb_offset, dtb_bufsize,
+			initrd_buf, initrds.total_size);
+	if (nextents < 0) {
+		res = -1;
+		goto out;
+	}
+
+	for (i = 0, nsegments = 0; i < n; i++)
+		if (pieces[i].staged)
+			nsegments = add_segments(NULL, nsegments, &pieces[i],
+					buffer, nextents);
+
+	if (nsegments > PURGATORY_MAX_SEGMENTS) {
+		warn("The kernel has too many segments");
+		res = -1;
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < nextents; j++) {
+			if (pieces[i].dest + pieces[i].memsz > extents[j].phys &&
+			    pieces[i].dest < extents[j].phys + extents[j].size) {
+				warn("The kernel is too big to be moved into place");
+				res = -1;
+				goto out;
+			}
+		}
+		if (initrd_in_mem2 &&
+		    pieces[i].dest + pieces[i].memsz > initrd_phys &&
+		    pieces[i].dest < initrd_phys + initrds.total_size) {
+			warn("The kernel would overwrite the initrd");
+			res = -1;
+			goto out;
+		}
+	}
+
+	struct purgatory_header *header = (void *)buffer;
+	memcpy(header, purgatory_bin, purgatory_size);
+
+	res = load_pieces(&kernel, pieces, n, buffer);
+	if (res < 0)
+		goto out;
+
+	res = load_source(&dtb, buffer + dtb_offset, "dtb");
+	if (res < 0)
+		goto out;
+
+	res = load_initrds(&initrd, &initrds, initrd_buf);
+	if (res < 0)
+		goto out;
+
+	screen = pick_screen(pieces, n);
+	res = patch_dtb(buffer + dtb_offset, dtb_bufsize, initrd_phys,
+			initrd_phys + initrds.total_size, screen);
+	if (res < 0)
+		goto out;
+
+	/* The purgatory moves the staged pieces into place */
+	for (i = 0, nsegments = 0; i < n; i++)
+		if (pieces[i].staged)
+			nsegments = add_segments(header, nsegments, &pieces[i],
+					buffer, nextents);
+
+	header->size = purgatory_size;
+	header->flags = PURGATORY_VERIFY;
+	/* The ARM mustn't draw over Linux's console, or over the kernel */
+	if (screen == 1 || !screen_is_free(pieces, n, 1))
+		header->flags |= PURGATORY_NO_DRC;
+	header->nsegments = nsegments;
+	header->kern_phys = entry;
+	header->dtb_phys = (uint32_t)OSEffectiveToPhysical(buffer + dtb_offset);
+	DCFlushRange(buffer, total_size);
+	if (initrd_in_mem2)
+		DCFlushRange(initrd_buf, initrds.total_size);
+
+	last_load.size = kernel.size + dtb.size + initrds.total_size;
+	last_load.ms = ms_since(start);
+	last_load.resident = 0;
+
+	/* The arena is reused by the next load, so an initrd in MEM2 can't be
+	 * restored later; such images aren't kept */
+	if (!initrd_in_mem2)
+		store_resident(fingerprint, buffer, total_size, pieces, n);
+
+	/* Let other functions see that we've loaded stuff */
+	contiguous_buffer = buffer;
+	res = 0;
+
+out:
+	close_sources(&kernel, &dtb);
+	return res;
+}
@@ -0,0 +1,47 @@
+/*
+ * Wii U Linux Launcher -- loading the kernel, the dtb, and the purgatory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#ifndef _LOAD_H
+#define _LOAD_H
+
+#include <stdint.h>
+
+/* Where boot() puts the ancast image. Nothing else may be loaded there. */
+#define ANCAST_ADDR		((void *)0xf5000000)
+#define ANCAST_MAX_SIZE		(2 << 20)
+#define ANCAST_PATH		"/vol/external01/wiiu/apps/linux/ancast.img"
+
+/* A memory buffer that contains the purgatory, the parts of the kernel that
+ * can't be loaded in place yet, the dtb, and the initrd. Allocated from the
+ * end of MEM1. NULL if nothing is loaded. The purgatory, the dtb, and the
+ * initrd are each physically contiguous; the kernel's pieces may be scattered
+ * (see extent.h). */
+extern void *contiguous_buffer;
+
+/* What the last successful load_stuff did */
+struct load_info {
+	uint32_t size;		/* of the kernel, dtb, and initrd */
+	uint32_t ms;		/* how long it took */
+	int resident;		/* whether it was still in MEM2 (see resident.h) */
+};
+
+extern struct load_info last_load;
+
+extern int load_stuff(void);
+
+#endif
@@ -29,10 +29,12 @@
 #include "settings.h"
 #include "version.h"
 #include "hax.h"
-
-/* A physically contiguous memory buffer that contains a small header, the
- * kernel, the dtb, and the initrd. Allocated from the end of MEM1. */
-static void *contiguous_buffer = NULL;
+#include "load.h"
+#include "resident.h"
+#include "bootstate.h"
+#include "lastboot.h"
+#include "ancast.h"
+#include "trace.h"
 
 static char *current_text = NULL;
 
@@ -45,7 +47,29 @@ static int keyboard_shown = 0;
 
 static int iosuhax = -1;
 
-/* Pointers to the raw framebuffers. [0] is TV, [1] is DRC. */
+/* The boot menu, which lists the entries of config.txt */
+static int menu_shown = 0;
+static int menu_selection = 0;
+
+/* The log of the last boot (see lastboot.h), and its first line on screen */
+static int log_shown = 0;
+static int log_first = 0;
+
+/* Which entry is loaded into MEM1, and how the entries were last loaded from
+ * the SD card */
+static int loaded_entry = -1;
+static struct load_info entry_info[CONFIG_MAX_ENTRIES];
+
+/* A/B booting: Booting the primary entry counts as an attempt, until Linux
+ * resets the counter (see bootstate.h). */
+#define DEFAULT_MAX_ATTEMPTS	3
+
+static int primary_entry = -1;
+static uint32_t boot_attempts;
+
+/* When to boot without being asked to (in OSGetTime ticks), or 0 */
+static uint64_t autoboot_time;
+
 uint32_t *framebuffers[2];
 
 void *xmalloc(size_t size, size_t alignment)
@@ -116,6 +140,71 @@ static void draw_status_line(void)
 	OSScreenPutFontEx(1, 49, 17, buf);
 }
 
+/* Only config files with sections have a menu */
+static int have_menu(void)
+{
+	return config->nentries > 0 && !(config->flags & CONFIG_LEGACY);
+}
+
+/*
+ *                   Wii U Linux Launcher
+ *
+ *   stable                      12.4 MiB   1830 ms  MEM1
+ * > rc                          13.0 MiB   2214 ms  MEM2
+ *   debug
+ *
+ * A: load   +: boot   X: edit
+ *
+ * Loading kernel...
+ *
+ * Git: abcd12345678                      OS_FIRMWARE: 550
+ *
+ * MEM1 is what's loaded right now, MEM2 means it can be loaded from there.
+ */
+#define MENU_ROWS	11
+
+static void draw_menu(void)
+{
+	const struct load_info *info;
+	const char *name, *where;
+	uint32_t tenths;
+	char line[128];
+	int i, y, first;
+
+	first = menu_selection - MENU_ROWS + 1;
+	if (first < 0)
+		first = 0;
+
+	for (i = first, y = 2; i < config->nentries && y < 2 + MENU_ROWS;
+			i++, y++) {
+		name = config_str(config, config->entries[i].name);
+		info = &entry_info[i];
+
+		if (i == loaded_entry && contiguous_buffer)
+			where = "MEM1";
+		else if (resident_find_owner(i) >= 0)
+			where = "MEM2";
+		else
+			where = "";
+
+		if (info->size) {
+			tenths = (info->size >> 10) * 10 >> 10;
+			OSScreenPrintf(2, y, line, "%-24s %4u.%u MiB %6u ms  %s",
+					name, tenths / 10, tenths % 10,
+					info->ms, where);
+		} else {
+			OSScreenPrintf(2, y, line, "%-24s %26s  %s",
+					name, "", where);
+		}
+	}
+
+	OSScreenPutFontBoth(0, 2 + menu_selection - first, "> ");
+	OSScreenPutFontBoth(2, 3 + MENU_ROWS, lastboot_nlines?
+			"A: load   +: boot   X: edit   Y: last boot" :
+			"A: load   +: boot   X: edit");
+	OSScreenPutFontBoth(0, 5 + MENU_ROWS, warning);
+}
+
 /*
  *                   Wii U Linux Launcher
  *
@@ -131,16 +220,11 @@ static void draw_status_line(void)
  *
  * Git: abcd12345678                      OS_FIRMWARE: 550
  */
-void draw_gui(void)
+static void draw_settings(void)
 {
 	char line[128];
 	int y;
 
-	OSScreenClearBufferBoth(0x488cd100); /* A nice blue background */
-
-	OSScreenPutFontEx(0, 39, 0, "Wii U Linux Launcher");
-	OSScreenPutFontEx(1, 21, 0, "Wii U Linux Launcher");
-
 	y = 2;
 	OSScreenPrintf(2, y++, line, "kernel  : %s", kernel_path);
 	OSScreenPrintf(2, y++, line, "dtb     : %s", dtb_path);
@@ -161,81 +245,78 @@ void draw_gui(void)
 	OSScreenPutFontBoth(0, 9, warning);
 
 	if (keyboard_shown) {
+		TRACE_BEGIN("keyboard_draw");
 		keyboard_draw(&keyboard);
+		TRACE_END("keyboard_draw");
 	}
-
-	draw_status_line();
-
-	OSScreenFlipBuffersBoth();
 }
 
-extern uint8_t purgatory[];
-extern uint8_t purgatory_end[];
-
-struct purgatory_header {
-	uint32_t jmp;		/* A jump instruction, to skip the header */
-	uint32_t size;		/* The size of the whole thing */
-	uint32_t dtb_phys;	/* physical address of the devicetree blob */
-	uint32_t kern_phys;	/* physical address of the kernel */
-};
+/*
+ *                   Wii U Linux Launcher
+ *
+ * arm: Racing the PPC bootrom
+ * arm: done
+ * arm: Memory console
+ * Hello world
+ * purgatory: moving 0x00000002 segments
+ * purgatory: entering the kernel at 0x00000100
+ *
+ * Up/Down: scroll   B: back
+ *
+ * Git: abcd12345678                      OS_FIRMWARE: 550
+ */
+#define LOG_ROWS	12
+#define LOG_COLS	66
 
-/* Get a chunk of MEM1 */
-static void *get_mem1_chunk(size_t size)
+static void draw_last_log(void)
 {
-	/* Perform alignment (I *think* this correct) */
-	size = -((-size) & (~0xfff));
-
-	/* Skip the framebuffers */
-	if (size > 0x02000000 - OSScreenGetBufferSizeEx(0) - OSScreenGetBufferSizeEx(1)) {
-		warnf("ERROR: Can't allocate %#x bytes from MEM1", size);
-		return NULL;
+	char line[LOG_COLS + 1];
+	const char *text;
+	int i, j, y, len;
+
+	for (i = log_first, y = 2; i < lastboot_nlines && y < 2 + LOG_ROWS;
+			i++, y++) {
+		text = lastboot_line(i, &len);
+		if (len > LOG_COLS)
+			len = LOG_COLS;
+
+		/* Tabs, escape sequences, etc. can't be shown */
+		for (j = 0; j < len; j++)
+			line[j] = (text[j] < ' ')? ' ' : text[j];
+		line[len] = '\0';
+
+		OSScreenPutFontBoth(2, y, line);
 	}
 
-	return (void *) (0xf4000000 + 0x02000000 - size);
+	if (lastboot_lost) {
+		OSScreenPrintf(2, 3 + LOG_ROWS, line,
+				"Up/Down: scroll   B: back   (%u bytes lost)",
+				lastboot_lost);
+	} else {
+		OSScreenPutFontBoth(2, 3 + LOG_ROWS,
+				"Up/Down: scroll   B: back");
+	}
 }
 
-/* https://www.kernel.org/doc/Documentation/devicetree/booting-without-of.txt */
-static int load_stuff(void)
+void draw_gui(void)
 {
-	size_t purgatory_size = purgatory_end - purgatory;
-	size_t total_size;
-	uint8_t *buffer;
-	int res;
-
-	contiguous_buffer = NULL;
+	TRACE_FUNC();
 
-	if (kernel_path[0] == '\0') {
-		warn("You need to specify a kernel!");
-		return 0;
-	}
-
-	size_t kernel_size = get_file_size(kernel_path, "kernel");
-
-
-	/* TODO: determine the size of initrd and dtb */
-
-	total_size = purgatory_size + kernel_size;
-	buffer = get_mem1_chunk(total_size);
-	if (!buffer)
-		return -1;
-
-	struct purgatory_header *header = (void *)buffer;
-	memcpy(header, purgatory, purgatory_size);
-
-	/* TODO: fill the header with all necessary information */
+	OSScreenClearBufferBoth(0x488cd100); /* A nice blue background */
 
-	size_t kernel_offset = purgatory_size;
-	res = read_file_into_buffer(kernel_path,
-			(u8 *)buffer + kernel_offset, kernel_size, "kernel");
-	if (res < 0)
-		return res;
+	OSScreenPutFontEx(0, 39, 0, "Wii U Linux Launcher");
+	OSScreenPutFontEx(1, 21, 0, "Wii U Linux Launcher");
 
-	/* TODO: patch initrd and cmdline into dtb */
+	if (log_shown)
+		draw_last_log();
+	else if (menu_shown)
+		draw_menu();
+	else
+		draw_settings();
 
-	/* Let other functions see that we've loaded stuff */
-	contiguous_buffer = buffer;
+	draw_status_line();
 
-	return 0;
+	OSScreenFlipBuffersBoth();
 }
 
 /* ARM code \o/ */
@@ -260,6 +341,23 @@ static void set_framebuffer_foreground(int fb)
 	}
 }
 
+/*
+ * Stage 2 of the ARM code is left in MEM2 for stage 1 to pick up, because
+ * only stage 1 has to go through the (slow and size-limited) upload.
+ */
+static void *arm_stage2_buffer;
+
+static void *stage_arm_code(void)
+{
+	if (!arm_stage2_buffer) {
+		arm_stage2_buffer = xmalloc(arm_stage2_len, 0x40);
+		memcpy(arm_stage2_buffer, arm_stage2, arm_stage2_len);
+		DCFlushRange(arm_stage2_buffer, arm_stage2_len);
+	}
+
+	return arm_stage2_buffer;
+}
+
 static void boot(void)
 {
 	const uint32_t arm_code = 0xfffff000;
@@ -267,23 +365,27 @@ static void boot(void)
 	if (!contiguous_buffer)
 		return;
 
+	flush_settings();
+
 	iosuhax = iosuhax_open();
 	if (iosuhax < 0)
 		return;
 
-	if (arm_bin_len > -arm_code) {
-		warnf("Error: The ARM binary is too big (%#x)", arm_bin_len);
+	if (arm_stage1_len > -arm_code) {
+		warnf("Error: ARM stage 1 is too big (%#x)", arm_stage1_len);
 		return;
 	}
 
-	void *ancast_addr = (void *)0xf5000000;
-	void *ppcboot_addr = (void *)0xf4000000;
-	memcpy(ppcboot_addr, purgatory, 0x38);
+	/* Stage 1 would find out when the PPC is already halted */
+	if (arm_stage2_unpacked_len > ARM_STAGE2_SIZE) {
+		warnf("Error: ARM stage 2 is too big (%#x)",
+				arm_stage2_unpacked_len);
+		return;
+	}
+
+	void *ancast_addr = ANCAST_ADDR;
 
-	/* TODO: load the ancast image directly from the NAND filesystem */
-	int ret = read_file_into_buffer(
-			"/vol/external01/wiiu/apps/linux/ancast.img",
-			ancast_addr, 2 << 20, "ancast image");
+	int ret = ancast_load(iosuhax, ancast_addr);
 
 	if (ret < 0)
 		return;
@@ -292,13 +394,23 @@ static void boot(void)
 	 * before we shutdown the PPC (using svc 0x53) */
 	DCFlushRange(ancast_addr, ret);
 
-	warn("loading ARM code into MEM1...");
+	warn("loading ARM code...");
 	draw_gui();
-	iosuhax_kern_write_buf(iosuhax, arm_code, arm_bin, arm_bin_len);
+	void *stage2 = stage_arm_code();
+	iosuhax_kern_write_buf(iosuhax, arm_code, arm_stage1, arm_stage1_len);
 	iosuhax_kern_write32(iosuhax, arm_code + 4,
 			(uint32_t)OSEffectiveToPhysical(ancast_addr));
+	/* The PPC enters the purgatory at the start of the buffer */
 	iosuhax_kern_write32(iosuhax, arm_code + 8,
-			(uint32_t)OSEffectiveToPhysical(ppcboot_addr));
+			(uint32_t)OSEffectiveToPhysical(contiguous_buffer));
+	/* See arm/start.S */
+	iosuhax_kern_write32(iosuhax, arm_code + 0x14,
+			(uint32_t)OSEffectiveToPhysical(stage2));
+	iosuhax_kern_write32(iosuhax, arm_code + 0x18, arm_stage2_len);
+
+	/* Nothing can fail from here on */
+	if (primary_entry >= 0 && loaded_entry == primary_entry)
+		bootstate_write(boot_attempts + 1);
 
 	warn("booting...");
 	/* Draw the GUI twice to make sure both the foreground
@@ -308,9 +420,22 @@ static void boot(void)
 
 	set_framebuffer_foreground(0);
 	set_framebuffer_foreground(1);
+
 	iosuhax_svc_0x53(iosuhax, arm_code);
 }
 
+/* Load the current settings, and remember how long it took */
+static void load(void)
+{
+	loaded_entry = -1;
+	if (load_stuff() < 0 || !contiguous_buffer)
+		return;
+
+	loaded_entry = current_entry;
+	if (current_entry >= 0 && !last_load.resident)
+		entry_info[current_entry] = last_load;
+}
+
 static void action(int what)
 {
 	warning[0] = '\0';
@@ -329,7 +454,7 @@ static void action(int what)
 			enter_keyboard(cmdline);
 			break;
 		case 4:
-			load_stuff();
+			load();
 			break;
 	}
 }
@@ -367,8 +492,87 @@ static void keyboard_cb(struct keyboard *keyb, int ch)
 	}
 }
 
+/* Switch to an entry, unless it's the current one (which may be edited) */
+static void menu_select(void)
+{
+	if (menu_selection != current_entry)
+		select_entry(menu_selection);
+}
+
+static void handle_menu_vpad(const VPADData *vpad)
+{
+	if (vpad->btns_d & VPAD_BUTTON_DOWN)
+		menu_selection++;
+	if (vpad->btns_d & VPAD_BUTTON_UP)
+		menu_selection--;
+
+	if (menu_selection < 0)
+		menu_selection = 0;
+	if (menu_selection > config->nentries - 1)
+		menu_selection = config->nentries - 1;
+
+	if (vpad->btns_d & VPAD_BUTTON_A) {
+		warning[0] = '\0';
+		menu_select();
+		load();
+	}
+
+	/* Loading an entry that is still in MEM2 takes no time */
+	if (vpad->btns_d & VPAD_BUTTON_PLUS) {
+		warning[0] = '\0';
+		menu_select();
+		if (loaded_entry != current_entry || !contiguous_buffer)
+			load();
+		boot();
+	}
+
+	if (vpad->btns_d & VPAD_BUTTON_X) {
+		warning[0] = '\0';
+		menu_select();
+		menu_shown = 0;
+	}
+}
+
+static void handle_log_vpad(const VPADData *vpad)
+{
+	int last = lastboot_nlines - LOG_ROWS;
+
+	if (vpad->btns_d & VPAD_BUTTON_DOWN)
+		log_first++;
+	if (vpad->btns_d & VPAD_BUTTON_UP)
+		log_first--;
+
+	if (log_first > last)
+		log_first = last;
+	if (log_first < 0)
+		log_first = 0;
+
+	if (vpad->btns_d & VPAD_BUTTON_B)
+		log_shown = 0;
+}
+
 static void handle_vpad(const VPADData *vpad)
 {
+	if (log_shown) {
+		handle_log_vpad(vpad);
+		return;
+	}
+
+	/* The end of the log is usually the interesting part */
+	if ((vpad->btns_d & VPAD_BUTTON_Y) && lastboot_nlines &&
+	    !keyboard_shown) {
+		log_first = lastboot_nlines - LOG_ROWS;
+		if (log_first < 0)
+			log_first = 0;
+		log_shown = 1;
+		return;
+	}
+
+	if (menu_shown) {
+		handle_menu_vpad(vpad);
+		return;
+	}
+
 	if (vpad->btns_d & VPAD_BUTTON_DOWN) {
 		exit_keyboard();
 		selection++;
@@ -387,6 +591,11 @@ static void handle_vpad(const VPADData *vpad)
 	if (vpad->btns_d & VPAD_BUTTON_A)
 		action(selection);
 
+	if ((vpad->btns_d & VPAD_BUTTON_B) && have_menu()) {
+		menu_selection = current_entry;
+		menu_shown = 1;
+	}
+
 	if (vpad->btns_d & VPAD_BUTTON_PLUS)
 		boot();
 
@@ -395,6 +604,97 @@ static void handle_vpad(const VPADData *vpad)
 	if (selection > 4) selection = 4;
 }
 
+/*
+ * If the primary entry has been booted too often without Linux resetting the
+ * counter, boot the fallback entry right away, without waiting for input.
+ */
+static int check_fallback(void)
+{
+	const char *primary = config_option(config, "primary");
+	const char *fallback = config_option(config, "fallback");
+	int max_attempts, index;
+
+	if (!primary)
+		return 0;
+
+	primary_entry = config_find_entry(config, primary);
+	if (primary_entry < 0) {
+		warnf("The primary entry (%s) doesn't exist", primary);
+		return 0;
+	}
+
+	if (!config_option(config, "default")) {
+		select_entry(primary_entry);
+		menu_selection = primary_entry;
+	}
+
+	max_attempts = config_option_int(config, "max_attempts",
+			DEFAULT_MAX_ATTEMPTS);
+	boot_attempts = bootstate_read();
+	if (boot_attempts < (uint32_t)max_attempts)
+		return 0;
+
+	index = fallback ? config_find_entry(config, fallback) : -1;
+	if (index < 0) {
+		warnf("%s failed to boot %u times, and there's no fallback",
+				primary, boot_attempts);
+		return 1;
+	}
+
+	warnf("%s failed to boot %u times, booting %s", primary,
+			boot_attempts, fallback);
+	select_entry(index);
+	menu_selection = index;
+	load();
+	boot();
+	return 1;
+}
+
+/*
+ * With "autoboot = seconds", the selected entry is loaded right away, and
+ * booted when the time is up (counting from now), unless a button is
+ * pressed in the meantime.
+ */
+static void start_autoboot(void)
+{
+	int timeout = config_option_int(config, "autoboot", -1);
+
+	if (timeout < 0)
+		return;
+
+	autoboot_time = OSGetTime() + (uint64_t)timeout * TIMER_CLOCK;
+	load();
+	if (!contiguous_buffer)
+		autoboot_time = 0;
+}
+
+static void handle_autoboot(const VPADData *vpad)
+{
+	const char *name = kernel_path;
+	int64_t left;
+
+	if (!autoboot_time)
+		return;
+
+	if (vpad->btns_h) {
+		autoboot_time = 0;
+		warn("Autoboot cancelled");
+		return;
+	}
+
+	left = autoboot_time - OSGetTime();
+	if (left <= 0) {
+		autoboot_time = 0;
+		boot();
+		return;
+	}
+
+	if (current_entry >= 0 && have_menu())
+		name = config_str(config, config->entries[current_entry].name);
+	warnf("Booting %s in %d s, press any button to cancel", name,
+			(int)((left + TIMER_CLOCK - 1) / TIMER_CLOCK));
+}
+
 static void init_screens(void)
 {
 	OSScreenInit();
@@ -421,11 +721,19 @@ int main(void)
 	keyboard_init(&keyboard, 0, 10);
 
 	fs_init();
+	lastboot_fetch();
 
 	load_settings();
+	if (have_menu()) {
+		menu_selection = current_entry;
+		menu_shown = 1;
+	}
+	if (!check_fallback())
+		start_autoboot();
 
+	/* Say hello, unless we're in a hurry */
 	uint32_t color = 0, i;
-	for (i = 0; i < 8; i++) {
+	for (i = 0; i < 8 && !autoboot_time; i++) {
 		OSScreenClearBufferBoth(color);
 		color += 0x11223344;
 
@@ -441,16 +749,24 @@ int main(void)
 		/* Read input events from the gamepad */
 		VPADRead(0, &vpad, 1, &err);
 
+		/* Without a gamepad, there's nothing to handle */
+		if (err)
+			memset(&vpad, 0, sizeof vpad);
+
 		if (vpad.btns_h & VPAD_BUTTON_HOME)
 			break;
 
+		handle_autoboot(&vpad);
 		handle_vpad(&vpad);
+		poll_settings();
 
 		draw_gui();
 
 		os_usleep(1000000 / 50);
 	}
 
+	flush_settings();
+	TRACE_DUMP();
 	fs_deinit();
 
 	return 0;
@@ -19,9 +19,16 @@
 #ifndef _MAIN_H
 #define _MAIN_H
 
+/* OSGetTime counts at a quarter of the bus clock */
+#define TIMER_CLOCK	(248625000 / 4)
+
 extern void *xmalloc(size_t size, size_t alignment);
 extern void xfree(void *ptr);
 
+/* Pointers to the raw framebuffers. [0] is TV, [1] is DRC. boot() leaves the
+ * first half of each on screen. */
+extern uint32_t *framebuffers[2];
+
 /* A warning or error message */
 extern char warning[1024];
 
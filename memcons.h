@@ -0,0 +1,67 @@
+/*
+ * Wii U Linux Launcher -- memory console protocol
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The memory console is a ring buffer in MEM0 that the PPC (purgatory, and
+ * later Linux) writes text into, and that the ARM displays on the gamepad.
+ *
+ * head and tail are free-running byte counters; the byte at position pos
+ * lives at data[pos & (size - 1)]. The PPC only ever writes head (and the
+ * data), the ARM only ever writes tail and overflow. They live in separate
+ * cache lines, so that neither side's cache flushes can clobber the other
+ * side's counter.
+ *
+ * The producer never waits for the consumer. If it gets more than size bytes
+ * ahead, the consumer skips the lost bytes and adds their number to
+ * overflow. Writing a NUL byte ends the console.
+ */
+
+#ifndef _MEMCONS_H
+#define _MEMCONS_H
+
+#define MEMCONS_PHYS		0x08200000
+#define MEMCONS_MAGIC		0x434f4e53	/* "CONS" */
+#define MEMCONS_SIZE		0x00040000	/* must be a power of two */
+
+#define MEMCONS_OFF_MAGIC	0x00
+#define MEMCONS_OFF_SIZE	0x04
+#define MEMCONS_OFF_HEAD	0x08
+#define MEMCONS_OFF_TAIL	0x20
+#define MEMCONS_OFF_OVERFLOW	0x24
+#define MEMCONS_OFF_DATA	0x40
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+struct memcons {
+	/* Written by the ARM during setup, then by the PPC */
+	uint32_t magic;
+	uint32_t size;
+	uint32_t head;
+	uint32_t pad0[5];
+
+	/* Written by the ARM */
+	uint32_t tail;
+	uint32_t overflow;
+	uint32_t pad1[6];
+
+	char data[];
+};
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Wii U Linux Launcher -- Checking image headers before loading
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <string.h>
+#include "fdt.h"
+#include "load.h"
+#include "preflight.h"
+
+/* The ancast header, as copy_ancast_image in arm/main.c checks it */
+#define ANCAST_MAGIC		0xefa282d9
+#define ANCAST_OFF_TYPE		0x20
+#define ANCAST_OFF_DEVICE	0xa4
+#define ANCAST_OFF_SIZE		0xac
+#define ANCAST_TYPE_PPC		1
+#define ANCAST_DEVICE_WIIU	0x11
+#define ANCAST_BODY_OFFSET	0x100
+
+static uint32_t be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+int preflight_dtb(const uint8_t *header, size_t len, uint32_t size)
+{
+	if (len < 40)
+		return PREFLIGHT_ERR_SHORT;
+	if (be32(header) != FDT_MAGIC)
+		return PREFLIGHT_ERR_DTB_MAGIC;
+	if (be32(header + 20) < 17)
+		return PREFLIGHT_ERR_DTB_VERSION;
+	if (fdt_check_header(header) < 0)
+		return PREFLIGHT_ERR_DTB_HEADER;
+	if (be32(header + 4) > size)
+		return PREFLIGHT_ERR_DTB_TRUNCATED;
+
+	return 0;
+}
+
+/*
+ * An initramfs (a cpio archive, or one compressed with something Linux can
+ * decompress), or an old-style initrd filesystem image.
+ */
+static const struct {
+	uint16_t offset;
+	uint8_t len;
+	const char *magic;
+} initrd_formats[] = {
+	{ 0,     6, "070701" },			/* cpio (newc) */
+	{ 0,     6, "070702" },			/* cpio (crc) */
+	{ 0,     2, "\x1f\x8b" },		/* gzip */
+	{ 0,     3, "BZh" },			/* bzip2 */
+	{ 0,     3, "\x5d\x00\x00" },		/* lzma */
+	{ 0,     6, "\xfd" "7zXZ\x00" },	/* xz */
+	{ 0,     4, "\x89LZO" },		/* lzo */
+	{ 0,     4, "\x02\x21\x4c\x18" },	/* lz4 (legacy) */
+	{ 0,     4, "\x28\xb5\x2f\xfd" },	/* zstd */
+	{ 0,     4, "hsqs" },			/* squashfs */
+	{ 0,     4, "\x45\x3d\xcd\x28" },	/* cramfs */
+	{ 0,     4, "\x28\xcd\x3d\x45" },	/* cramfs (big-endian) */
+	{ 0,     8, "-rom1fs-" },		/* romfs */
+	{ 0x438, 2, "\x53\xef" },		/* ext2 */
+};
+
+int preflight_initrd(const uint8_t *header, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(initrd_formats) / sizeof(initrd_formats[0]); i++)
+		if (initrd_formats[i].offset + initrd_formats[i].len <= len &&
+		    memcmp(header + initrd_formats[i].offset,
+			   initrd_formats[i].magic, initrd_formats[i].len) == 0)
+			return 0;
+
+	return PREFLIGHT_ERR_INITRD_FORMAT;
+}
+
+int preflight_ancast(const uint8_t *header, size_t len, uint32_t size)
+{
+	uint32_t body;
+
+	if (len < ANCAST_OFF_SIZE + 4)
+		return PREFLIGHT_ERR_SHORT;
+	if (be32(header) != ANCAST_MAGIC)
+		return PREFLIGHT_ERR_ANCAST_MAGIC;
+	if (be32(header + ANCAST_OFF_TYPE) != ANCAST_TYPE_PPC)
+		return PREFLIGHT_ERR_ANCAST_TYPE;
+	if (be32(header + ANCAST_OFF_DEVICE) != ANCAST_DEVICE_WIIU)
+		return PREFLIGHT_ERR_ANCAST_DEVICE;
+
+	body = be32(header + ANCAST_OFF_SIZE);
+	if (body > ANCAST_MAX_SIZE - ANCAST_BODY_OFFSET)
+		return PREFLIGHT_ERR_ANCAST_SIZE;
+	if (body + ANCAST_BODY_OFFSET > size)
+		return PREFLIGHT_ERR_ANCAST_TRUNCATED;
+
+	return 0;
+}
+
+const char *preflight_strerror(int error)
+{
+	switch (error) {
+	case 0:				return "success";
+	case PREFLIGHT_ERR_SHORT:	return "too short";
+	case PREFLIGHT_ERR_DTB_MAGIC:	return "bad magic";
+	case PREFLIGHT_ERR_DTB_VERSION:	return "version older than 17";
+	case PREFLIGHT_ERR_DTB_HEADER:	return "bad header";
+	case PREFLIGHT_ERR_DTB_TRUNCATED: return "truncated";
+	case PREFLIGHT_ERR_INITRD_FORMAT: return "not cpio, compressed, or a filesystem";
+	case PREFLIGHT_ERR_ANCAST_MAGIC: return "bad magic";
+	case PREFLIGHT_ERR_ANCAST_TYPE:	return "not for the PPC";
+	case PREFLIGHT_ERR_ANCAST_DEVICE: return "not for Wii U mode";
+	case PREFLIGHT_ERR_ANCAST_SIZE:	return "too big";
+	case PREFLIGHT_ERR_ANCAST_TRUNCATED: return "truncated";
+	default:			return "unknown error";
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ * Wii U Linux Launcher -- Checking image headers before loading
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Before anything big is read, the launcher looks at the first few bytes of
+ * the dtb, each initrd, and the ancast image, so that a wrong file is
+ * reported right away, and not after tens of megabytes have been read.
+ * (The kernel's headers are checked by elf_parse.) These functions only look
+ * at the bytes they are given, so that they can be tested on the build host.
+ */
+
+#ifndef _PREFLIGHT_H
+#define _PREFLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* How much of the start of a file the checks need */
+#define PREFLIGHT_HEADER_SIZE	0x440
+
+/*
+ * Errors, always negative, and out of the range of the FS library's status
+ * codes, so that the two can't be mistaken for each other
+ */
+#define PREFLIGHT_ERR_SHORT		-101
+#define PREFLIGHT_ERR_DTB_MAGIC		-102
+#define PREFLIGHT_ERR_DTB_VERSION	-103
+#define PREFLIGHT_ERR_DTB_HEADER	-104
+#define PREFLIGHT_ERR_DTB_TRUNCATED	-105
+#define PREFLIGHT_ERR_INITRD_FORMAT	-106
+#define PREFLIGHT_ERR_ANCAST_MAGIC	-107
+#define PREFLIGHT_ERR_ANCAST_TYPE	-108
+#define PREFLIGHT_ERR_ANCAST_DEVICE	-109
+#define PREFLIGHT_ERR_ANCAST_SIZE	-110
+#define PREFLIGHT_ERR_ANCAST_TRUNCATED	-111
+
+/*
+ * header holds the first len bytes of a file (or of an image in a FIT
+ * image), which is size bytes long. Each function returns 0 or an error.
+ */
+extern int preflight_dtb(const uint8_t *header, size_t len, uint32_t size);
+extern int preflight_initrd(const uint8_t *header, size_t len);
+extern int preflight_ancast(const uint8_t *header, size_t len, uint32_t size);
+
+extern const char *preflight_strerror(int error);
+
+#endif
@@ -0,0 +1,303 @@
+/*
+ * Wii U Linux Launcher
+ * purgatory.c: Move the kernel into place, and tell start.S where to jump
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include "purgatory.h"
+#include "../boottime.h"
+#include "../memcons.h"
+
+/* The size of a cache line on Espresso */
+#define LINE	32
+
+#ifdef PURGATORY_SIM
+/*
+ * Built for the host (see tools/purgsim.c): Physical memory is simulated by
+ * a buffer, and there are no caches to take care of.
+ */
+extern uint8_t *purgatory_sim_mem;
+#define PHYS(addr)	((void *)(purgatory_sim_mem + (addr)))
+
+static inline void ppc_dcbz(void *p)
+{
+	__builtin_memset(p, 0, LINE);
+}
+
+static inline void ppc_dcbst(void *p) { }
+static inline void ppc_icbi(void *p) { }
+static inline void ppc_sync(void) { }
+static inline void ppc_isync(void) { }
+
+static inline void ppc_mftb(uint32_t *tbu, uint32_t *tbl)
+{
+	*tbu = *tbl = 0;
+}
+#else
+#define PHYS(addr)	((void *)(addr))
+
+static inline void ppc_dcbz(void *p)
+{
+	asm volatile("dcbz 0, %0" : : "r"(p) : "memory");
+}
+
+static inline void ppc_dcbst(void *p)
+{
+	asm volatile("dcbst 0, %0" : : "r"(p) : "memory");
+}
+
+static inline void ppc_icbi(void *p)
+{
+	asm volatile("icbi 0, %0" : : "r"(p) : "memory");
+}
+
+static inline void ppc_sync(void)
+{
+	asm volatile("sync" : : : "memory");
+}
+
+static inline void ppc_isync(void)
+{
+	asm volatile("isync" : : : "memory");
+}
+
+static inline void ppc_mftb(uint32_t *tbu, uint32_t *tbl)
+{
+	uint32_t again;
+
+	do {
+		asm volatile("mftbu %0" : "=r"(*tbu));
+		asm volatile("mftb %0" : "=r"(*tbl));
+		asm volatile("mftbu %0" : "=r"(again));
+	} while (*tbu != again);
+}
+#endif
+
+/*
+ * Memory console output (see memcons.h). The PPC is the producer, so all we
+ * have to do is write the data and then advance head.
+ */
+static void cons_puts(const char *str)
+{
+	struct memcons *cons = PHYS(MEMCONS_PHYS);
+	uint32_t head = cons->head, start = head, i;
+
+	if (cons->magic != MEMCONS_MAGIC)
+		return;
+
+	for (; *str; str++)
+		cons->data[head++ & (cons->size - 1)] = *str;
+
+	for (i = start & ~(LINE - 1); i < head; i += LINE)
+		ppc_dcbst(&cons->data[i & (cons->size - 1)]);
+	ppc_sync();
+
+	cons->head = head;
+	ppc_dcbst(&cons->head);
+	ppc_sync();
+}
+
+static void cons_hex(uint32_t x)
+{
+	char buf[11];
+	int i;
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (i = 0; i < 8; i++)
+		buf[2 + i] = "0123456789abcdef"[(x >> (28 - 4 * i)) & 0xf];
+	buf[10] = '\0';
+
+	cons_puts(buf);
+}
+
+/* Note down the current time in the boot timing record (see boottime.h) */
+static void stamp(int n)
+{
+	struct boottime *bt = PHYS(BOOTTIME_PHYS);
+
+	if (bt->magic != BOOTTIME_MAGIC)
+		return;
+
+	ppc_mftb(&bt->ppc[n].tbu, &bt->ppc[n].tbl);
+	if (bt->ppc_count < n + 1)
+		bt->ppc_count = n + 1;
+
+	ppc_dcbst(&bt->ppc[n]);
+	ppc_dcbst(&bt->ppc_count);
+	ppc_sync();
+}
+
+/*
+ * Copy towards lower addresses. Whole destination lines are established
+ * with dcbz, so that they aren't read from RAM before being overwritten,
+ * except where that would clobber source bytes that haven't been read yet.
+ */
+static void copy_forward(uint8_t *d, const uint8_t *s, uint32_t n)
+{
+	uint8_t *end = d + n;
+
+	while (((uintptr_t)d & (LINE - 1)) && d < end)
+		*d++ = *s++;
+
+	if ((((uintptr_t)s) & 3) == 0) {
+		while (end - d >= LINE) {
+			uint32_t *dw = (void *)d;
+			const uint32_t *sw = (const void *)s;
+
+			if (d + LINE <= s || d >= s + (end - d))
+				ppc_dcbz(d);
+
+			dw[0] = sw[0]; dw[1] = sw[1]; dw[2] = sw[2]; dw[3] = sw[3];
+			dw[4] = sw[4]; dw[5] = sw[5]; dw[6] = sw[6]; dw[7] = sw[7];
+			d += LINE;
+			s += LINE;
+		}
+	}
+
+	while (d < end)
+		*d++ = *s++;
+}
+
+/* Copy towards higher addresses, where the ranges overlap */
+static void copy_backward(uint8_t *d, const uint8_t *s, uint32_t n)
+{
+	d += n;
+	s += n;
+
+	if ((((uintptr_t)d ^ (uintptr_t)s) & 3) == 0) {
+		while (((uintptr_t)d & 3) && n) {
+			*--d = *--s;
+			n--;
+		}
+
+		for (; n >= 4; n -= 4) {
+			d -= 4;
+			s -= 4;
+			*(uint32_t *)d = *(const uint32_t *)s;
+		}
+	}
+
+	while (n--)
+		*--d = *--s;
+}
+
+static void zero(uint8_t *d, uint32_t n)
+{
+	uint8_t *end = d + n;
+
+	while (((uintptr_t)d & (LINE - 1)) && d < end)
+		*d++ = 0;
+
+	for (; end - d >= LINE; d += LINE)
+		ppc_dcbz(d);
+
+	while (d < end)
+		*d++ = 0;
+}
+
+/* Write a range back to RAM, and make sure it's not stale in the icache */
+static void flush(uint8_t *p, uint32_t n)
+{
+	uint8_t *start = (uint8_t *)((uintptr_t)p & ~(LINE - 1)), *q;
+
+	for (q = start; q < p + n; q += LINE)
+		ppc_dcbst(q);
+	ppc_sync();
+
+	for (q = start; q < p + n; q += LINE)
+		ppc_icbi(q);
+	ppc_sync();
+	ppc_isync();
+}
+
+static int verify(const struct purgatory_header *hdr)
+{
+	const struct purgatory_segment *seg;
+	uint32_t i, csum;
+
+	for (i = 0; i < hdr->nsegments; i++) {
+		seg = &hdr->segments[i];
+		csum = purgatory_csum(PHYS(seg->src), seg->filesz);
+		if (csum != seg->csum) {
+			cons_puts("purgatory: bad checksum in segment at ");
+			cons_hex(seg->src);
+			cons_puts("\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void move_segment(const struct purgatory_segment *seg)
+{
+	uint8_t *d = PHYS(seg->dest);
+	const uint8_t *s = PHYS(seg->src);
+
+	if (d != s) {
+		if (d < s || d >= s + seg->filesz)
+			copy_forward(d, s, seg->filesz);
+		else
+			copy_backward(d, s, seg->filesz);
+	}
+
+	zero(d + seg->filesz, seg->memsz - seg->filesz);
+	flush(d, seg->memsz);
+}
+
+/*
+ * Returns the address of the kernel entry point, or 0 if the kernel
+ * shouldn't be entered.
+ *
+ * The launcher orders the segments so that moving one never overwrites the
+ * source of a later one.
+ */
+uint32_t purgatory_main(struct purgatory_header *hdr)
+{
+	uint32_t i;
+
+	stamp(BOOTTIME_PPC_ENTRY);
+	cons_puts("purgatory: moving ");
+	cons_hex(hdr->nsegments);
+	cons_puts(" segments\n");
+
+	if (hdr->nsegments > PURGATORY_MAX_SEGMENTS) {
+		cons_puts("purgatory: too many segments\n");
+		return 0;
+	}
+
+	for (i = 0; i < hdr->nsegments; i++) {
+		if (hdr->segments[i].memsz < hdr->segments[i].filesz) {
+			cons_puts("purgatory: bad segment\n");
+			return 0;
+		}
+	}
+
+	if ((hdr->flags & PURGATORY_VERIFY) && verify(hdr) < 0)
+		return 0;
+
+	for (i = 0; i < hdr->nsegments; i++)
+		move_segment(&hdr->segments[i]);
+
+	cons_puts("purgatory: entering the kernel at ");
+	cons_hex(hdr->kern_phys);
+	cons_puts("\n");
+
+	stamp(BOOTTIME_PPC_KERNEL);
+	return hdr->kern_phys;
+}
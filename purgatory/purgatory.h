@@ -0,0 +1,108 @@
+/*
+ * Wii U Linux Launcher -- interface between the launcher and the purgatory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * The purgatory is the code that runs on the PPC after CafeOS and before the
+ * new kernel. The launcher copies the purgatory binary into the buffer that
+ * also holds the kernel and the dtb, fills in the header at its start, and
+ * makes the PPC jump to the first word of the header.
+ *
+ * The purgatory then copies itself to PURGATORY_RUN_ADDR (in MEM0), so that
+ * it can't be overwritten by the segments it moves, moves the segments to
+ * their destination, and enters the kernel with r3 = dtb_phys,
+ * r4 = kern_phys, r5 = 0.
+ *
+ * All addresses in the header are physical.
+ */
+
+#ifndef _PURGATORY_H
+#define _PURGATORY_H
+
+#define PURGATORY_RUN_ADDR	0x082d0000
+#define PURGATORY_RUN_SIZE	0x00010000	/* including the stack */
+
+#define PURGATORY_MAX_SEGMENTS	8
+#define PURGATORY_HEADER_SIZE	(0x20 + PURGATORY_MAX_SEGMENTS * 0x18)
+
+/* Header flags */
+#define PURGATORY_VERIFY	0x00000001	/* check segment checksums */
+#define PURGATORY_NO_DRC	0x00000002	/* the gamepad's framebuffer is
+						   off limits to the ARM once
+						   the PPC runs (see
+						   arm/main.c) */
+
+/* Offsets for use in assembly code */
+#define PURGATORY_OFF_SIZE	0x04
+#define PURGATORY_OFF_DTB	0x08
+#define PURGATORY_OFF_KERN	0x0c
+#define PURGATORY_OFF_FLAGS	0x10
+
+#ifndef __ASSEMBLER__
+#include <stddef.h>
+#include <stdint.h>
+
+struct purgatory_segment {
+	uint32_t src;		/* where the launcher left the data */
+	uint32_t dest;		/* where it has to go */
+	uint32_t filesz;	/* how many bytes to copy */
+	uint32_t memsz;		/* filesz, plus the bytes to zero after them */
+	uint32_t csum;		/* purgatory_csum() of the filesz bytes at src */
+	uint32_t pad;
+};
+
+struct purgatory_header {
+	uint32_t jmp;		/* A jump instruction, to skip the header */
+	uint32_t size;		/* The size of the purgatory binary */
+	uint32_t dtb_phys;	/* physical address of the devicetree blob */
+	uint32_t kern_phys;	/* physical address of the kernel entry point */
+	uint32_t flags;
+	uint32_t nsegments;
+	uint32_t pad[2];
+	struct purgatory_segment segments[PURGATORY_MAX_SEGMENTS];
+};
+
+/*
+ * The checksum used for the segment table: Adler-32. It's cheap enough to
+ * verify the whole kernel before entering it, and is used by both the
+ * launcher and the purgatory, so it lives here.
+ */
+static inline uint32_t purgatory_csum(const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	uint32_t a = 1, b = 0;
+	size_t n;
+
+	while (len) {
+		/* 5552 bytes is the most that can be summed without overflow */
+		n = (len < 5552)? len : 5552;
+		len -= n;
+
+		while (n--) {
+			a += *p++;
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return (b << 16) | a;
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Wii U Linux Launcher -- Keep loaded images in MEM2
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <os_functions.h>
+#include "main.h"
+#include "hash.h"
+#include "resident.h"
+#include "arena.h"
+
+/* How much of the default heap is left for everything else */
+#define RESIDENT_HEADROOM	(16 << 20)
+
+struct resident {
+	int used;
+	int owner;		/* a config entry, as far as we're concerned */
+	uint8_t fingerprint[HASH_MAX_SIZE];
+	uint32_t last_used;
+
+	void *buffer;		/* contiguous_buffer, in MEM1 */
+	uint8_t *data;		/* the copy of all regions, in MEM2 */
+	uint32_t size;
+	int nregions;
+	struct resident_region regions[RESIDENT_MAX_REGIONS];
+};
+
+static struct resident slots[RESIDENT_SLOTS];
+static uint32_t use_counter;
+
+static void drop(struct resident *r)
+{
+	xfree(r->data);
+	r->data = NULL;
+	r->used = 0;
+}
+
+/* Drop the least recently used copy. Returns -1 if there is none. */
+int resident_drop_lru(void)
+{
+	struct resident *lru = NULL;
+	int i;
+
+	for (i = 0; i < RESIDENT_SLOTS; i++)
+		if (slots[i].used && (!lru || slots[i].last_used < lru->last_used))
+			lru = &slots[i];
+
+	if (!lru)
+		return -1;
+
+	drop(lru);
+	return 0;
+}
+
+static struct resident *get_free_slot(void)
+{
+	int i;
+
+	for (i = 0; i < RESIDENT_SLOTS; i++)
+		if (!slots[i].used)
+			return &slots[i];
+
+	resident_drop_lru();
+	return get_free_slot();
+}
+
+static void *alloc_copy(uint32_t size)
+{
+	int heap = MEMGetBaseHeapHandle(MEM_ARENA_2);
+
+	while (MEMGetAllocatableSizeForExpHeapEx(heap, 0x40) <
+			size + RESIDENT_HEADROOM)
+		if (resident_drop_lru() < 0)
+			return NULL;
+
+	return xmalloc(size, 0x40);
+}
+
+int resident_find(const uint8_t *fingerprint)
+{
+	int i;
+
+	for (i = 0; i < RESIDENT_SLOTS; i++)
+		if (slots[i].used && memcmp(slots[i].fingerprint, fingerprint,
+					HASH_MAX_SIZE) == 0)
+			return i;
+
+	return -1;
+}
+
+int resident_find_owner(int owner)
+{
+	int i;
+
+	for (i = 0; i < RESIDENT_SLOTS; i++)
+		if (slots[i].used && slots[i].owner == owner)
+			return i;
+
+	return -1;
+}
+
+/* Copy an image back into MEM1. Returns its size. */
+uint32_t resident_restore(int slot, void **buffer)
+{
+	struct resident *r = &slots[slot];
+	const struct resident_region *reg;
+	uint8_t *data = r->data;
+	int i;
+
+	for (i = 0; i < r->nregions; i++) {
+		reg = &r->regions[i];
+		memcpy(reg->addr, data, reg->size);
+		DCFlushRange(reg->addr, reg->size);
+		data += reg->size;
+	}
+
+	r->last_used = ++use_counter;
+	*buffer = r->buffer;
+	return r->size;
+}
+
+/*
+ * Copy an image out of MEM1. An older copy with the same owner is replaced.
+ * If there isn't enough memory, the image simply isn't kept.
+ */
+void resident_store(const uint8_t *fingerprint, int owner, void *buffer,
+		const struct resident_region *regions, int nregions)
+{
+	struct resident *r;
+	uint32_t size = 0;
+	uint8_t *data;
+	int i;
+
+	if (nregions > RESIDENT_MAX_REGIONS)
+		return;
+
+	for (i = 0; i < RESIDENT_SLOTS; i++) {
+		if (slots[i].used && (slots[i].owner == owner ||
+		    memcmp(slots[i].fingerprint, fingerprint, HASH_MAX_SIZE) == 0))
+			drop(&slots[i]);
+	}
+
+	r = get_free_slot();
+	for (i = 0; i < nregions; i++)
+		size += regions[i].size;
+
+	data = alloc_copy(size);
+	if (!data)
+		return;
+
+	r->used = 1;
+	r->owner = owner;
+	memcpy(r->fingerprint, fingerprint, HASH_MAX_SIZE);
+	r->last_used = ++use_counter;
+	r->buffer = buffer;
+	r->data = data;
+	r->size = size;
+	r->nregions = nregions;
+	memcpy(r->regions, regions, nregions * sizeof(*regions));
+
+	for (i = 0; i < nregions; i++) {
+		memcpy(data, regions[i].addr, regions[i].size);
+		data += regions[i].size;
+	}
+}
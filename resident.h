@@ -0,0 +1,48 @@
+/*
+ * Wii U Linux Launcher -- Keep loaded images in MEM2
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * After an entry has been loaded, the parts of MEM1 that were written are
+ * copied to MEM2. Loading the same entry again (with the same files) only
+ * has to copy them back, which is much faster than reading the SD card.
+ * The least recently used copies are dropped when MEM2 runs low.
+ */
+
+#ifndef _RESIDENT_H
+#define _RESIDENT_H
+
+#include <stdint.h>
+
+#define RESIDENT_SLOTS		4
+#define RESIDENT_MAX_REGIONS	32
+
+/* A part of MEM1 that belongs to a loaded image */
+struct resident_region {
+	void *addr;
+	uint32_t size;
+};
+
+extern int resident_find(const uint8_t *fingerprint);
+extern uint32_t resident_restore(int slot, void **buffer);
+extern void resident_store(const uint8_t *fingerprint, int owner,
+		void *buffer, const struct resident_region *regions,
+		int nregions);
+extern int resident_find_owner(int owner);
+extern int resident_drop_lru(void);
+
+#endif
@@ -21,12 +21,56 @@
 #include <os_functions.h>
 #include "main.h"
 #include "fs.h"
+#include "settings.h"
 
 char kernel_path[256];
 char dtb_path[256];
 char initrd_path[256];
 char cmdline[256];
 
+/*
+ * The parsed config.txt is kept in config.bin, behind a header that says
+ * which config.txt it belongs to. If size and mtime still match, the launcher
+ * doesn't need to parse anything on startup.
+ */
+#define CACHE_MAGIC	0x57554c43	/* "WULC" */
+#define CACHE_VERSION	1		/* bump when struct config changes */
+
+struct config_cache {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t text_size;
+	uint32_t pad;
+	uint64_t text_mtime;
+	char sdcard[FS_MAX_MOUNTPATH_SIZE];
+
+	struct config config;
+} __attribute__((aligned(0x40)));
+
+#define CACHE_HEADER_SIZE	offsetof(struct config_cache, config)
+
+/* Edits are written to config.txt once there were none for this long */
+#define SAVE_DELAY	(2 * TIMER_CLOCK)
+
+/*
+ * The longest text that format_settings can produce: the four settings and
+ * their labels, and the options, whose keys and values are all in the
+ * config's pool
+ */
+#define SETTINGS_TEXT_SIZE	(4 * 256 + 32 + CONFIG_POOL_SIZE + \
+				 2 * CONFIG_MAX_OPTIONS)
+
+/* What config.txt says, as far as the current settings are concerned */
+static char saved_text[SETTINGS_TEXT_SIZE];
+static int saved_len;
+
+/* When to write config.txt, or 0 */
+static uint64_t save_time;
+
+static struct config_cache cache;
+struct config *config = &cache.config;
+int current_entry = -1;
+
 static void load_default_settings(void)
 {
 	snprintf(kernel_path, sizeof kernel_path,
@@ -37,102 +81,189 @@ static void load_default_settings(void)
 	snprintf(cmdline, sizeof cmdline, "", 0);
 }
 
-static void get_config_path(char *buf, size_t size)
+static void get_config_path(char *buf, size_t size, const char *name)
 {
-	snprintf(buf, size, "%s/wiiu/apps/linux/config.txt", sdcard_path);
+	snprintf(buf, size, "%s/wiiu/apps/linux/%s", sdcard_path, name);
 }
 
-/* Find the first newline or return NULL */
-static char *find_newline(char *str)
+static int load_cache(const FSStat *stat)
 {
-	char *p;
-
-	for (p = str; *p; p++)
-		if (*p == '\n' || *p == '\r')
-			return p;
+	char path[256];
+	int res;
 
-	return NULL;
-}
+	get_config_path(path, sizeof path, "config.bin");
+	res = read_file_into_buffer(path, (u8 *)&cache, sizeof cache, NULL);
+	if (res < (int)CACHE_HEADER_SIZE)
+		return -1;
 
-/* Does a start with b? */
-static int starts_with(const char *string, const char *pattern)
-{
-	size_t i;
+	if (cache.magic != CACHE_MAGIC || cache.version != CACHE_VERSION ||
+	    cache.text_size != stat->size || cache.text_mtime != stat->mtime ||
+	    strncmp(cache.sdcard, sdcard_path, sizeof cache.sdcard) != 0)
+		return -1;
 
-	for (i = 0;; i++) {
-		if (pattern[i] == '\0')
-			return 1;
-		if (string[i] != pattern[i])
-			return 0;
-	}
-}
+	if (config_check(config) < 0 ||
+	    res != CACHE_HEADER_SIZE + CONFIG_USED_SIZE(config))
+		return -1;
 
-static void parse_settings(char *string)
-{
-	char *line, *next = string;
-	char *newline;
-
-	while (next) {
-		line = next;
-
-		newline = find_newline(line);
-		if (newline) {
-			*newline = '\0';
-			next = newline + 1;
-		} else {
-			next = NULL;
-		}
-
-		if (starts_with(line, "kernel="))
-			snprintf(kernel_path, sizeof kernel_path, "%s", line + 7);
-		else if (starts_with(line, "dtb="))
-			snprintf(dtb_path, sizeof dtb_path, "%s", line + 4);
-		else if (starts_with(line, "initrd="))
-			snprintf(initrd_path, sizeof initrd_path, "%s", line + 7);
-		else if (starts_with(line, "cmdline="))
-			snprintf(cmdline, sizeof cmdline, "%s", line + 8);
-
-		/* ignore everything else */
-	}
+	return 0;
 }
 
-static int try_load_settings(void)
+static int parse_config(const FSStat *stat)
 {
+	char path[256];
 	int res;
-	char path[256], buf[1024];
 
-	get_config_path(path, sizeof path);
-	res = get_file_size(path, NULL);
-	if (res == 0)
+	if (stat->size > CONFIG_MAX_TEXT) {
+		warnf("config.txt is too big (%u bytes)", stat->size);
 		return -1;
+	}
 
-	res = read_file_into_buffer(path, (u8 *)buf, sizeof(buf) - 1, NULL);
+	get_config_path(path, sizeof path, "config.txt");
+	res = read_file_into_buffer(path, (u8 *)config_text(config),
+			stat->size, NULL);
 	if (res < 0)
 		return res;
-	buf[res] = '\0';
 
-	parse_settings(buf);
+	res = config_parse(config, res, sdcard_path);
+	if (res < 0) {
+		warnf("config.txt:%d: %s", config->error_line,
+				config_strerror(res));
+		return res;
+	}
+
+	/* Failing to write the cache only costs time on the next start */
+	cache.magic = CACHE_MAGIC;
+	cache.version = CACHE_VERSION;
+	cache.text_size = stat->size;
+	cache.pad = 0;
+	cache.text_mtime = stat->mtime;
+	snprintf(cache.sdcard, sizeof cache.sdcard, "%s", sdcard_path);
+
+	get_config_path(path, sizeof path, "config.bin");
+	write_buffer_into_file(path, (u8 *)&cache,
+			CACHE_HEADER_SIZE + CONFIG_USED_SIZE(config));
 
 	return 0;
 }
 
+/*
+ * Write the settings in the format of a config file without sections.
+ * Returns the length, or -1 if the text doesn't fit (and would be cut off).
+ */
+static int format_settings(char *buf, size_t size)
+{
+	int i, res;
+
+	res = snprintf(buf, size,
+			"kernel=%s\ndtb=%s\ninitrd=%s\ncmdline=%s\n",
+			kernel_path, dtb_path, initrd_path, cmdline);
+
+	/* Keep the options, such as autoboot */
+	for (i = 0; i < config->noptions && res < size; i++)
+		res += snprintf(buf + res, size - res, "%s=%s\n",
+				config_str(config, config->options[i].key),
+				config_str(config, config->options[i].value));
+
+	/* snprintf returns how long the text would be, had it fit */
+	return (res < size)? res : -1;
+}
+
+void select_entry(int index)
+{
+	const struct config_entry *e = &config->entries[index];
+
+	snprintf(kernel_path, sizeof kernel_path, "%s",
+			config_str(config, e->kernel));
+	snprintf(dtb_path, sizeof dtb_path, "%s",
+			config_str(config, e->dtb));
+	snprintf(initrd_path, sizeof initrd_path, "%s",
+			config_str(config, e->initrd));
+	snprintf(cmdline, sizeof cmdline, "%s",
+			config_str(config, e->cmdline));
+
+	current_entry = index;
+}
+
 void load_settings(void)
 {
-	int res = try_load_settings();
+	FSStat stat;
+	char path[256];
+	const char *name;
+	int index = -1;
 
-	if (res < 0)
-		load_default_settings();
+	load_default_settings();
+
+	/* Without a config file, the settings can be saved as a new one */
+	get_config_path(path, sizeof path, "config.txt");
+	fs_recover_file(path);
+	if (fs_stat(path, &stat) < 0 || stat.size == 0) {
+		config->nentries = 0;
+		config->flags = CONFIG_LEGACY;
+		saved_len = format_settings(saved_text, sizeof saved_text);
+		return;
+	}
+
+	if (load_cache(&stat) < 0 && parse_config(&stat) < 0) {
+		config->nentries = 0;
+		config->flags = 0;
+		return;
+	}
+
+	name = config_option(config, "default");
+	if (name)
+		index = config_find_entry(config, name);
+	select_entry((index >= 0)? index : 0);
+	saved_len = format_settings(saved_text, sizeof saved_text);
 }
 
+/*
+ * Only a config file with a single entry is written back. The settings of
+ * one with sections aren't saved; they are edited in config.txt.
+ *
+ * Edits are collected for a little while, and then written in one go, and
+ * only if something has actually changed. save_settings only schedules the
+ * write; poll_settings or flush_settings perform it.
+ */
 void save_settings(void)
 {
-	char buf[1024], path[256];
-	int res;
+	if (!(config->flags & CONFIG_LEGACY))
+		return;
 
-	get_config_path(path, sizeof buf);
-	res = snprintf(buf, sizeof buf,
-			"kernel=%s\ndtb=%s\ninitrd=%s\ncmdline=%s\n",
-			kernel_path, dtb_path, initrd_path, cmdline);
+	save_time = OSGetTime() + SAVE_DELAY;
+}
+
+void flush_settings(void)
+{
+	static char buf[sizeof saved_text];
+	char path[256];
+	int len, res;
 
-	write_buffer_into_file(path, (u8 *)buf, res);
+	if (!save_time)
+		return;
+	save_time = 0;
+
+	len = format_settings(buf, sizeof buf);
+	if (len < 0) {
+		warn("Not saving config.txt: the settings are too long");
+		return;
+	}
+	if (len == saved_len && memcmp(buf, saved_text, len) == 0)
+		return;
+
+	get_config_path(path, sizeof path, "config.txt");
+	res = fs_replace_file(path, (u8 *)buf, len);
+	if (res < 0) {
+		warnf("Failed to save config.txt: %s (%d)", FS_strerror(res),
+				res);
+		return;
+	}
+
+	memcpy(saved_text, buf, len);
+	saved_len = len;
+}
+
+void poll_settings(void)
+{
+	if (save_time && (int64_t)(OSGetTime() - save_time) >= 0)
+		flush_settings();
 }
@@ -19,13 +19,22 @@
 #ifndef _SETTINGS_H
 #define _SETTINGS_H
 
+#include "config.h"
+
 /* Paths of the files to be loaded */
 extern char kernel_path[256];
 extern char dtb_path[256];
 extern char initrd_path[256];
 extern char cmdline[256];
 
+/* All of config.txt, and which entry the paths above come from */
+extern struct config *config;
+extern int current_entry;
+
+extern void select_entry(int index);
 extern void load_settings(void);
 extern void save_settings(void);
+extern void poll_settings(void);
+extern void flush_settings(void);
 
 #endif
@@ -16,17 +16,41 @@
  * with this program, in the file LICENSE.GPLv2.
  */
 
+#include <stdint.h>
 #include <string.h>
+#include "trace.h"
+
+/*
+ * memset is used to clear large areas (e.g. the BSS of a kernel), so it
+ * stores whole words, and clears whole cache lines with dcbz, which doesn't
+ * even have to read them from RAM first.
+ */
+#define CACHE_LINE	32
 
 void *memset(void *s, int c, size_t n)
 {
-	char *p = s;
-	size_t i;
+	unsigned char *p = s, *end = p + n;
+	uint32_t word = (unsigned char)c * 0x01010101;
 
-	for (i = 0; i < n; i++) {
-		p[i] = c;
+	while (((uintptr_t)p & 3) && p < end)
+		*p++ = c;
+
+	if (c == 0) {
+		while (((uintptr_t)p & (CACHE_LINE - 1)) && end - p >= 4) {
+			*(uint32_t *)p = 0;
+			p += 4;
+		}
+
+		for (; end - p >= CACHE_LINE; p += CACHE_LINE)
+			asm volatile("dcbz 0, %0" : : "r"(p) : "memory");
 	}
 
+	for (; end - p >= 4; p += 4)
+		*(uint32_t *)p = word;
+
+	while (p < end)
+		*p++ = c;
+
 	return s;
 }
 
@@ -36,6 +60,8 @@ void *memcpy(void *dest, const void *src, size_t n)
 	char *d = dest;
 	size_t i;
 
+	TRACE_FUNC();
+
 	for (i = 0; i < n; i++) {
 		d[i] = s[i];
 	}
@@ -43,6 +69,45 @@ void *memcpy(void *dest, const void *src, size_t n)
 	return dest;
 }
 
+void *memmove(void *dest, const void *src, size_t n)
+{
+	const char *s = src;
+	char *d = dest;
+	size_t i;
+
+	if (d <= s)
+		return memcpy(dest, src, n);
+
+	for (i = n; i > 0; i--)
+		d[i - 1] = s[i - 1];
+
+	return dest;
+}
+
+void *memchr(const void *s, int c, size_t n)
+{
+	const unsigned char *p = s;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		if (p[i] == (unsigned char)c)
+			return (void *)(p + i);
+
+	return NULL;
+}
+
+int memcmp(const void *a, const void *b, size_t n)
+{
+	const unsigned char *au = a, *bu = b;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		if (au[i] != bu[i])
+			return (au[i] > bu[i]) - (au[i] < bu[i]);
+
+	return 0;
+}
+
 size_t strlen(const char *s)
 {
 	size_t res = 0;
@@ -53,6 +118,37 @@ size_t strlen(const char *s)
 	return res;
 }
 
+char *strcpy(char *dest, const char *src)
+{
+	char *d = dest;
+
+	while ((*d++ = *src++))
+		;
+
+	return dest;
+}
+
+char *strchr(const char *s, int c)
+{
+	for (; *s; s++)
+		if (*s == (char)c)
+			return (char *)s;
+
+	return (c == '\0')? (char *)s : NULL;
+}
+
+char *strrchr(const char *s, int c)
+{
+	const char *last = NULL;
+
+	do {
+		if (*s == (char)c)
+			last = s;
+	} while (*s++);
+
+	return (char *)last;
+}
+
 #undef strcmp
 int strcmp(const char *a, const char *b)
 {
@@ -67,5 +163,23 @@ int strcmp(const char *a, const char *b)
 			return 1;
 	}
 
+	/* One string may be a prefix of the other */
+	return (au[i] > bu[i]) - (au[i] < bu[i]);
+}
+
+#undef strncmp
+int strncmp(const char *a, const char *b, size_t n)
+{
+	size_t i;
+	const unsigned char *au = (const unsigned char *)a;
+	const unsigned char *bu = (const unsigned char *)b;
+
+	for (i = 0; i < n; i++) {
+		if (au[i] != bu[i])
+			return (au[i] > bu[i]) - (au[i] < bu[i]);
+		if (au[i] == '\0')
+			break;
+	}
+
 	return 0;
 }
@@ -0,0 +1,223 @@
+/*
+ * Wii U Linux Launcher -- Test and benchmark the config file parser
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Usage: cfgtest dump FILE
+ *        cfgtest bench [ENTRIES]
+ *        cfgtest fuzz [ITERATIONS [SEED]]
+ *
+ * dump parses a config.txt and prints the entries. bench generates a file
+ * with the given number of entries and measures how long parsing takes. fuzz
+ * parses randomly mutated versions of a generated file, and checks that the
+ * result is consistent (see config_check) whenever parsing succeeds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../config.h"
+
+#define SDCARD	"/vol/external01"
+
+static struct config config;
+
+static void dump(const struct config *c)
+{
+	const struct config_entry *e;
+	int i;
+
+	for (i = 0; i < c->noptions; i++)
+		printf("%s = %s\n", config_str(c, c->options[i].key),
+				config_str(c, c->options[i].value));
+
+	for (i = 0; i < c->nentries; i++) {
+		e = &c->entries[i];
+		printf("\n[%s]\n", config_str(c, e->name));
+		printf("kernel  = %s\n", config_str(c, e->kernel));
+		printf("dtb     = %s\n", config_str(c, e->dtb));
+		printf("initrd  = %s\n", config_str(c, e->initrd));
+		printf("cmdline = %s\n", config_str(c, e->cmdline));
+	}
+
+	printf("\n%s%u of %u pool bytes used\n",
+			(c->flags & CONFIG_LEGACY)? "legacy, " : "",
+			c->pool_used, CONFIG_POOL_SIZE);
+}
+
+/* Write a config file with n entries into buf, and return its length */
+static size_t generate(char *buf, size_t size, int n)
+{
+	size_t len;
+	int i;
+
+	len = snprintf(buf, size,
+			"# generated\n"
+			"default = linux-%d\n"
+			"dir = ${sdcard}/wiiu/linux\n"
+			"dtb = ${dir}/wiiu.dtb\n"
+			"cmdline = root=/dev/mmcblk0p2 rootwait\n",
+			n / 2);
+
+	for (i = 0; i < n && len < size; i++)
+		len += snprintf(buf + len, size - len,
+				"\n[linux-%d]\n"
+				"kernel = ${dir}/vmlinux-4.%d\n"
+				"initrd = ${dir}/initrd-4.%d.cpio\n"
+				"cmdline = ${cmdline} console=tty%d\n",
+				i, i, i, i % 2);
+
+	return (len < size)? len : size;
+}
+
+static int cmd_dump(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	size_t len;
+	int res;
+
+	if (!f) {
+		perror(filename);
+		return 1;
+	}
+
+	len = fread(config_text(&config), 1, CONFIG_MAX_TEXT + 1, f);
+	fclose(f);
+
+	res = config_parse(&config, len, SDCARD);
+	if (res < 0) {
+		fprintf(stderr, "%s:%d: %s\n", filename, config.error_line,
+				config_strerror(res));
+		return 1;
+	}
+
+	dump(&config);
+	return 0;
+}
+
+static int cmd_bench(int n)
+{
+	static char text[CONFIG_MAX_TEXT];
+	struct timespec start, end;
+	size_t len = generate(text, sizeof text, n);
+	double ns;
+	int i, res = 0, runs = 10000;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < runs && res == 0; i++) {
+		memcpy(config_text(&config), text, len);
+		res = config_parse(&config, len, SDCARD);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (res < 0) {
+		fprintf(stderr, "line %d: %s\n", config.error_line,
+				config_strerror(res));
+		return 1;
+	}
+
+	ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+	printf("%d entries, %zu bytes of text, %u pool bytes: %.2f us per parse\n",
+			config.nentries, len, config.pool_used, ns / runs / 1000);
+	return 0;
+}
+
+static void mutate(char *text, size_t *len)
+{
+	static const char interesting[] = "[]=$${}#\n\r \t";
+	size_t pos = rand() % (*len + 1);
+	char ch;
+
+	if (rand() % 2)
+		ch = interesting[rand() % (sizeof(interesting) - 1)];
+	else
+		ch = rand();
+
+	switch (rand() % 3) {
+	case 0:		/* overwrite */
+		if (pos < *len)
+			text[pos] = ch;
+		break;
+	case 1:		/* insert */
+		if (*len < CONFIG_MAX_TEXT) {
+			memmove(text + pos + 1, text + pos, *len - pos);
+			text[pos] = ch;
+			(*len)++;
+		}
+		break;
+	case 2:		/* delete */
+		if (pos < *len) {
+			memmove(text + pos, text + pos + 1, *len - pos - 1);
+			(*len)--;
+		}
+		break;
+	}
+}
+
+static int cmd_fuzz(long iterations, unsigned seed)
+{
+	static char orig[CONFIG_MAX_TEXT], text[CONFIG_MAX_TEXT];
+	size_t orig_len, len;
+	long i, ok = 0;
+	int j, res;
+
+	srand(seed);
+	orig_len = generate(orig, sizeof orig, 8);
+
+	for (i = 0; i < iterations; i++) {
+		memcpy(text, orig, orig_len);
+		len = orig_len;
+		for (j = rand() % 16; j >= 0; j--)
+			mutate(text, &len);
+
+		/* Random garbage after the text must not be looked at */
+		memset(config.pool, 0xa5, sizeof config.pool);
+		memcpy(config_text(&config), text, len);
+
+		res = config_parse(&config, len, SDCARD);
+		if (res < 0)
+			continue;
+		ok++;
+
+		if (config_check(&config) < 0 || config.nentries == 0) {
+			fprintf(stderr, "iteration %ld: inconsistent result\n", i);
+			fwrite(text, 1, len, stderr);
+			return 1;
+		}
+	}
+
+	printf("%ld iterations, %ld parsed successfully\n", iterations, ok);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && !strcmp(argv[1], "dump"))
+		return cmd_dump(argv[2]);
+
+	if (argc >= 2 && !strcmp(argv[1], "bench"))
+		return cmd_bench((argc > 2)? atoi(argv[2]) : 30);
+
+	if (argc >= 2 && !strcmp(argv[1], "fuzz"))
+		return cmd_fuzz((argc > 2)? atol(argv[2]) : 100000,
+				(argc > 3)? atoi(argv[3]) : 1);
+
+	fprintf(stderr, "Usage: %s dump FILE | bench [ENTRIES] | "
+			"fuzz [ITERATIONS [SEED]]\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,200 @@
+/*
+ * Wii U Linux Launcher -- Pack a payload for the ARM decompression stub
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Usage: lzpack <input> <output>
+ *
+ * Compresses input into the format described in arm/unlz.h, checks that
+ * arm/unlz.c decompresses it back to the original data, and reports the
+ * compressed size.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../arm/unlz.h"
+
+#define HASH_BITS	12
+#define MIN_MATCH	4
+#define MAX_OFFSET	0xffff
+
+/* The LZ4 format wants the last five bytes to be literals, and the last match
+ * to start at least 12 bytes before the end. */
+#define LAST_LITERALS	5
+#define MATCH_LIMIT	12
+
+static uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static unsigned hash(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static uint8_t *put_len(uint8_t *d, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*d++ = 255;
+	*d++ = len;
+	return d;
+}
+
+/* Emit one sequence: literals, followed by a match (if match_len != 0) */
+static uint8_t *put_sequence(uint8_t *d, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len)
+{
+	uint8_t *token = d++;
+
+	*token = (lit_len >= 15 ? 15 : lit_len) << 4;
+	if (lit_len >= 15)
+		d = put_len(d, lit_len - 15);
+	memcpy(d, lit, lit_len);
+	d += lit_len;
+
+	if (match_len) {
+		*d++ = offset;
+		*d++ = offset >> 8;
+		match_len -= MIN_MATCH;
+		*token |= match_len >= 15 ? 15 : match_len;
+		if (match_len >= 15)
+			d = put_len(d, match_len - 15);
+	}
+
+	return d;
+}
+
+/* Greedy LZ4 compression with a single-entry hash table */
+static size_t compress(uint8_t *dst, const uint8_t *src, size_t size)
+{
+	static size_t table[1 << HASH_BITS];
+	size_t i = 0, anchor = 0;
+	uint8_t *d = dst;
+
+	memset(table, 0xff, sizeof table);
+
+	while (size >= MATCH_LIMIT && i + MATCH_LIMIT <= size) {
+		uint32_t v = read32(src + i);
+		unsigned h = hash(v);
+		size_t cand = table[h], len;
+
+		table[h] = i;
+		if (cand == (size_t)-1 || i - cand > MAX_OFFSET ||
+		    read32(src + cand) != v) {
+			i++;
+			continue;
+		}
+
+		len = MIN_MATCH;
+		while (i + len < size - LAST_LITERALS &&
+		       src[cand + len] == src[i + len])
+			len++;
+
+		d = put_sequence(d, src + anchor, i - anchor, i - cand, len);
+		i += len;
+		anchor = i;
+	}
+
+	d = put_sequence(d, src + anchor, size - anchor, 0, 0);
+
+	return d - dst;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static uint8_t *read_file(const char *name, size_t *size)
+{
+	FILE *f = fopen(name, "rb");
+	uint8_t *buf;
+	long len;
+
+	if (!f) {
+		perror(name);
+		exit(1);
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	buf = malloc(len + 1);
+	if (!buf || fread(buf, 1, len, f) != (size_t)len) {
+		perror(name);
+		exit(1);
+	}
+	fclose(f);
+
+	*size = len;
+	return buf;
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t *in, *out, *check;
+	size_t in_size, out_size, lz_size;
+	FILE *f;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+		return 1;
+	}
+
+	in = read_file(argv[1], &in_size);
+
+	/* Worst case: everything is literals */
+	out = calloc(1, UNLZ_HEADER + in_size + in_size / 255 + 16 + 4);
+	check = malloc(in_size + 1);
+	if (!out || !check) {
+		perror("malloc");
+		return 1;
+	}
+
+	lz_size = compress(out + UNLZ_HEADER, in, in_size);
+	put_be32(out, UNLZ_MAGIC);
+	put_be32(out + 4, lz_size);
+	put_be32(out + 8, in_size);
+	out_size = (UNLZ_HEADER + lz_size + 3) & ~3;
+
+	/* Make sure that the decompressor agrees with us */
+	if (unlz(check, out) != in_size || memcmp(check, in, in_size) != 0) {
+		fprintf(stderr, "%s: round trip failed!\n", argv[1]);
+		return 1;
+	}
+
+	f = fopen(argv[2], "wb");
+	if (!f || fwrite(out, 1, out_size, f) != out_size || fclose(f) != 0) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	printf("%s: %zu -> %zu bytes (%zu%%)\n", argv[1], in_size, out_size,
+			in_size ? 100 * out_size / in_size : 100);
+
+	return 0;
+}
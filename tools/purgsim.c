@@ -0,0 +1,140 @@
+/*
+ * Wii U Linux Launcher -- Run the purgatory against simulated memory
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Usage: purgsim [-v]
+ *
+ * Builds purgatory/purgatory.c for the host, and lets it move segments around
+ * in a buffer that stands in for physical memory. The result is compared to
+ * what memmove and memset would have done. With -v, the purgatory's memory
+ * console output is printed.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../purgatory/purgatory.h"
+#include "../memcons.h"
+
+/* Up to the end of the purgatory's area in MEM0 */
+#define SIM_SIZE	(PURGATORY_RUN_ADDR + PURGATORY_RUN_SIZE)
+
+/* Only this much (MEM1) is compared after each case */
+#define CHECK_SIZE	0x02000000
+
+#define HEADER_PHYS	0x01f00000
+
+uint8_t *purgatory_sim_mem;
+extern uint32_t purgatory_main(struct purgatory_header *hdr);
+
+struct sim_case {
+	const char *name;
+	uint32_t src, dest, filesz, memsz;
+	int corrupt;		/* store a wrong checksum */
+};
+
+static const struct sim_case cases[] = {
+	{ "disjoint",		0x01800000, 0x00000000, 0x00123456, 0x00140000 },
+	{ "overlap, down by 16", 0x00100010, 0x00100000, 0x00010000, 0x00010000 },
+	{ "overlap, down by 64", 0x00100040, 0x00100000, 0x00010003, 0x00010100 },
+	{ "overlap, up",	0x00200000, 0x00201003, 0x00008000, 0x00009000 },
+	{ "unaligned",		0x00300005, 0x00400003, 0x00001001, 0x00001001 },
+	{ "in place",		0x00500000, 0x00500000, 0x00000100, 0x00000200 },
+	{ "bad checksum",	0x00600000, 0x00000000, 0x00001000, 0x00001000, 1 },
+};
+
+static void fill(uint8_t *p, size_t len, uint32_t seed)
+{
+	while (len--) {
+		seed = seed * 1103515245 + 12345;
+		*p++ = (seed >> 16) | 1;
+	}
+}
+
+static int run_case(const struct sim_case *c, uint8_t *shadow)
+{
+	struct purgatory_header *hdr = (void *)(purgatory_sim_mem + HEADER_PHYS);
+	struct purgatory_segment *seg = &hdr->segments[0];
+	uint32_t ret;
+
+	fill(purgatory_sim_mem, CHECK_SIZE, c->src ^ c->dest);
+	memset(hdr, 0, sizeof(*hdr));
+
+	hdr->kern_phys = c->dest;
+	hdr->flags = PURGATORY_VERIFY;
+	hdr->nsegments = 1;
+	seg->src = c->src;
+	seg->dest = c->dest;
+	seg->filesz = c->filesz;
+	seg->memsz = c->memsz;
+	seg->csum = purgatory_csum(purgatory_sim_mem + c->src, c->filesz);
+	if (c->corrupt)
+		seg->csum ^= 1;
+
+	memcpy(shadow, purgatory_sim_mem, CHECK_SIZE);
+	if (!c->corrupt) {
+		memmove(shadow + c->dest, shadow + c->src, c->filesz);
+		memset(shadow + c->dest + c->filesz, 0, c->memsz - c->filesz);
+	}
+
+	ret = purgatory_main(hdr);
+
+	if (ret != (c->corrupt ? 0 : c->dest)) {
+		fprintf(stderr, "%s: purgatory returned %#x\n", c->name, ret);
+		return -1;
+	}
+
+	if (memcmp(shadow, purgatory_sim_mem, CHECK_SIZE)) {
+		fprintf(stderr, "%s: memory contents differ\n", c->name);
+		return -1;
+	}
+
+	printf("%s: ok\n", c->name);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct memcons *cons;
+	uint8_t *shadow;
+	size_t i;
+	int res = 0;
+
+	purgatory_sim_mem = calloc(1, SIM_SIZE);
+	shadow = malloc(CHECK_SIZE);
+	if (!purgatory_sim_mem || !shadow) {
+		perror("malloc");
+		return 1;
+	}
+
+	cons = (void *)(purgatory_sim_mem + MEMCONS_PHYS);
+	cons->magic = MEMCONS_MAGIC;
+	cons->size = MEMCONS_SIZE;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+		if (run_case(&cases[i], shadow) < 0)
+			res = 1;
+
+	if (argc > 1 && !strcmp(argv[1], "-v"))
+		fwrite(cons->data, 1, cons->head, stdout);
+
+	free(shadow);
+	free(purgatory_sim_mem);
+	return res;
+}
@@ -0,0 +1,180 @@
+/*
+ * Wii U Linux Launcher -- Timing instrumentation
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Each core only ever writes to its own ring buffer, so no locking is
+ * needed, as long as only one thread per core is traced (the launcher only
+ * has one). Timestamps come from the PowerPC time base, which is what
+ * OSGetTime counts too. On the build host (see host/), clock_gettime is
+ * used instead.
+ */
+
+#ifdef TRACE
+
+#include <stdint.h>
+#include <string.h>
+#include <os_functions.h>
+#include "main.h"
+#include "fs.h"
+#include "trace.h"
+
+#ifdef __powerpc__
+#define TRACE_CLOCK	TIMER_CLOCK
+
+static inline uint64_t trace_time(void)
+{
+	uint32_t tbu, tbl, again;
+
+	do {
+		asm volatile("mftbu %0" : "=r"(tbu));
+		asm volatile("mftb %0" : "=r"(tbl));
+		asm volatile("mftbu %0" : "=r"(again));
+	} while (tbu != again);
+
+	return (uint64_t)tbu << 32 | tbl;
+}
+
+/* UPIR, the core's ID */
+static inline int trace_core(void)
+{
+	uint32_t upir;
+
+	asm volatile("mfspr %0, 1007" : "=r"(upir));
+	return upir % TRACE_CORES;
+}
+#else
+#include <time.h>
+
+#define TRACE_CLOCK	1000000000
+
+static inline uint64_t trace_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline int trace_core(void)
+{
+	return 0;
+}
+#endif
+
+struct trace_record {
+	uint64_t time;
+	const char *name;
+	char phase;		/* 'B' or 'E' */
+};
+
+struct trace_ring {
+	uint32_t head;		/* counts up, and wraps around in ev */
+	struct trace_record ev[TRACE_RING_SIZE];
+};
+
+static struct trace_ring rings[TRACE_CORES];
+
+/* Set while dumping, so that the dump doesn't trace itself */
+static int dumping;
+
+void trace_event(const char *name, char phase)
+{
+	struct trace_ring *ring = &rings[trace_core()];
+	struct trace_record *r;
+
+	if (dumping)
+		return;
+
+	/* Assigned one by one, because a struct copy may call memcpy */
+	r = &ring->ev[ring->head++ & (TRACE_RING_SIZE - 1)];
+	r->time = trace_time();
+	r->name = name;
+	r->phase = phase;
+}
+
+/* Where the oldest event that is still in a ring is */
+static uint32_t oldest(const struct trace_ring *ring)
+{
+	return ring->head > TRACE_RING_SIZE? ring->head - TRACE_RING_SIZE : 0;
+}
+
+static const struct trace_record *get_record(const struct trace_ring *ring,
+		uint32_t i)
+{
+	return &ring->ev[i & (TRACE_RING_SIZE - 1)];
+}
+
+static int write_record(struct fs_writer *w, const struct trace_record *r,
+		int core, uint64_t start, int first)
+{
+	uint64_t us = (r->time - start) * 1000000;
+	char buf[160];
+
+	snprintf(buf, sizeof buf, "%s{\"name\":\"%s\",\"ph\":\"%c\","
+			"\"ts\":%u.%03u,\"pid\":0,\"tid\":%d}",
+			first? "" : ",\n", r->name, r->phase,
+			(uint32_t)(us / TRACE_CLOCK),
+			(uint32_t)(us % TRACE_CLOCK * 1000 / TRACE_CLOCK), core);
+
+	return fs_writer_write(w, buf, strlen(buf));
+}
+
+/* Write the recorded events to trace.json. Timestamps start at zero. */
+void trace_dump(void)
+{
+	struct fs_writer w;
+	const struct trace_ring *ring;
+	uint64_t start = ~0ull;
+	uint32_t i;
+	char path[256];
+	int core, n = 0, res;
+
+	dumping = 1;
+
+	for (core = 0; core < TRACE_CORES; core++) {
+		ring = &rings[core];
+		if (ring->head && get_record(ring, oldest(ring))->time < start)
+			start = get_record(ring, oldest(ring))->time;
+	}
+
+	snprintf(path, sizeof path, "%s/wiiu/apps/linux/trace.json",
+			sdcard_path);
+	res = fs_writer_open(&w, path);
+	if (res < 0) {
+		warnf("Can't write trace.json: %s (%d)", FS_strerror(res), res);
+		dumping = 0;
+		return;
+	}
+
+	fs_writer_write(&w, "{\"traceEvents\":[\n", 17);
+	for (core = 0; core < TRACE_CORES; core++) {
+		ring = &rings[core];
+		for (i = oldest(ring); i != ring->head; i++)
+			write_record(&w, get_record(ring, i), core, start,
+					n++ == 0);
+	}
+	fs_writer_write(&w, "\n]}\n", 4);
+
+	res = fs_writer_close(&w);
+	if (res < 0)
+		warnf("Can't write trace.json: %s (%d)", FS_strerror(res), res);
+
+	dumping = 0;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Wii U Linux Launcher -- Timing instrumentation
+ *
+ * Copyright (C) 2017  Jonathan Neuschäfer <j.neuschaefer@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program, in the file LICENSE.GPLv2.
+ */
+
+/*
+ * Built with TRACE defined (make TRACE=1), the functions that are bracketed
+ * with these macros note down when they start and end, in a ring buffer per
+ * CPU core. trace_dump writes the most recent events to trace.json, next to
+ * config.txt, in the Chrome trace event format; open it in chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * Without TRACE, the macros expand to nothing.
+ *
+ *	void draw_gui(void)
+ *	{
+ *		TRACE_FUNC();
+ *		...
+ *	}
+ *
+ * TRACE_FUNC records the end of the function when it returns, wherever that
+ * happens. TRACE_BEGIN and TRACE_END bracket anything else; the names must
+ * be string literals.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_RING_SIZE		8192	/* events per core, a power of two */
+#define TRACE_CORES		3
+
+#ifdef TRACE
+
+extern void trace_event(const char *name, char phase);
+extern void trace_dump(void);
+
+static inline void trace_scope_end(const char **name)
+{
+	trace_event(*name, 'E');
+}
+
+#define TRACE_BEGIN(name)	trace_event(name, 'B')
+#define TRACE_END(name)		trace_event(name, 'E')
+#define TRACE_FUNC() \
+	const char *trace_scope __attribute__((cleanup(trace_scope_end))) = \
+		__func__; \
+	trace_event(__func__, 'B')
+#define TRACE_DUMP()		trace_dump()
+
+#else
+
+#define TRACE_BEGIN(name)	do { } while (0)
+#define TRACE_END(name)		do { } while (0)
+#define TRACE_FUNC()		do { } while (0)
+#define TRACE_DUMP()		do { } while (0)
+
+#endif
+
+#endif
@@ -1,6 +1,6 @@
 #!/bin/sh
 
-VERSION=`git describe --always --abbrev=12`
+VERSION=${VERSION:-`git describe --always --abbrev=12`}
 if [ -z "$VERSION" ]; then VERSION=unknown; fi
 
 cat << __EOF__